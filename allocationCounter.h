@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+/* Replaces the global operator new/delete (all their forms) with versions
+ * counting the heap allocations and the bytes allocated, for the tests and
+ * the benchmarks. Include it in a single source file of an executable.
+ */
+
+static std::atomic<size_t> g_allocations(0);
+static std::atomic<size_t> g_allocatedBytes(0);
+
+// not inlined: the compiler would otherwise pair the malloc() of operator new
+// with the delete of the callers and warn (-Wmismatched-new-delete)
+#if defined(_MSC_VER)
+#define ALLOCATION_COUNTER_NOINLINE __declspec(noinline)
+#elif defined(__GNUC__) || defined(__clang__)
+#define ALLOCATION_COUNTER_NOINLINE __attribute__((noinline))
+#else
+#define ALLOCATION_COUNTER_NOINLINE
+#endif
+
+ALLOCATION_COUNTER_NOINLINE static void* countedMalloc(const size_t size)
+{
+    ++g_allocations;
+    g_allocatedBytes += size;
+    return std::malloc(size ? size : 1);
+}
+
+ALLOCATION_COUNTER_NOINLINE static void countedFree(void* p)
+{
+    std::free(p);
+}
+
+void* operator new(size_t size)
+{
+    if (void* p = countedMalloc(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    if (void* p = countedMalloc(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return countedMalloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return countedMalloc(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    countedFree(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    countedFree(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    countedFree(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+    countedFree(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+    countedFree(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+    countedFree(p);
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "lineSplitter.h"
+
+#include <cstdint>
+
+namespace LineSplitter
+{
+
+/* Random-access arc-length queries on a polyline: point and tangent at the
+ * distance 's' from the first point.
+ *
+ * The index is built once from the cumulative distances of the polyline. The
+ * segment containing 's' is found with a binary search, or, when a bucket
+ * count is given, through a table splitting [0, length] in equal buckets that
+ * gives the candidate segments in O(1) (on average, for evenly distributed
+ * vertices).
+ *
+ * The index doesn't copy the points: they must outlive it. Queries require a
+ * valid index (at least 2 points).
+ */
+template <typename P>
+class ArcLengthIndex
+{
+public:
+    ArcLengthIndex() : _bucketScale(0.) {}
+
+    explicit ArcLengthIndex(Span<const P> points, const size_t bucketCount = 0)
+    {
+        build(points, bucketCount);
+    }
+
+    void build(Span<const P> points, const size_t bucketCount = 0)
+    {
+        _points = points;
+        _dists.resize(points.size);
+        _buckets.clear();
+        _bucketScale = 0.;
+
+        if (points.empty())
+            return;
+
+        _dists[0] = 0.;
+        for (size_t i = 1; i < points.size; ++i)
+            _dists[i] = _dists[i - 1] + distance(points[i - 1], points[i]);
+
+        if (bucketCount == 0 || points.size < 2 || length() <= 0.)
+            return;
+
+        // _buckets[b] = first segment whose end falls in bucket b or after
+        _bucketScale = bucketCount / length();
+        _buckets.resize(bucketCount + 1);
+        size_t segment = 1;
+        for (size_t b = 0; b < bucketCount; ++b)
+        {
+            while (segment < points.size - 1 && bucketOf(_dists[segment]) < b)
+                ++segment;
+            _buckets[b] = uint32_t(segment);
+        }
+        _buckets[bucketCount] = uint32_t(points.size - 1);
+    }
+
+    bool isValid() const { return _points.size >= 2; }
+    double length() const { return _dists.empty() ? 0. : _dists.back(); }
+    const std::vector<double>& cumulativeDistances() const { return _dists; }
+
+    /* Index i of the segment (i - 1, i) containing the distance s,
+     * which is clamped to [0, length()]. */
+    size_t segmentAt(double s) const
+    {
+        s = clamp(s);
+        const double* dists = _dists.data();
+        size_t first = 1;
+        size_t last = _points.size - 1;
+        if (!_buckets.empty())
+        {
+            const size_t b = bucketOf(s);
+            first = _buckets[b];
+            last = _buckets[b + 1];
+        }
+        return size_t(std::lower_bound(dists + first, dists + last, s) - dists);
+    }
+
+    /* Point at the distance s along the polyline. */
+    P pointAt(const double s) const
+    {
+        typedef PointTraits<P> Traits;
+        typedef typename Traits::Scalar Scalar;
+
+        const size_t i = segmentAt(s);
+        const double t = ratio(i, clamp(s));
+        const P& a = _points[i - 1];
+        const P& b = _points[i];
+        return Traits::make(Scalar((1 - t) * Traits::x(a) + t * Traits::x(b)),
+                            Scalar((1 - t) * Traits::y(a) + t * Traits::y(b)));
+    }
+
+    /* Unit direction of the polyline at s ((0, 0) on zero-length segments). */
+    P tangentAt(const double s) const
+    {
+        typedef PointTraits<P> Traits;
+        typedef typename Traits::Scalar Scalar;
+
+        const size_t i = segmentAt(s);
+        const double segmentLength = _dists[i] - _dists[i - 1];
+        if (segmentLength <= 0.)
+            return Traits::make(Scalar(0), Scalar(0));
+
+        const P& a = _points[i - 1];
+        const P& b = _points[i];
+        return Traits::make(Scalar((double(Traits::x(b)) - Traits::x(a)) / segmentLength),
+                            Scalar((double(Traits::y(b)) - Traits::y(a)) / segmentLength));
+    }
+
+private:
+    double clamp(const double s) const
+    {
+        return s < 0. ? 0. : (s > length() ? length() : s);
+    }
+
+    size_t bucketOf(const double s) const
+    {
+        const size_t b = size_t(s * _bucketScale);
+        return b < _buckets.size() - 1 ? b : _buckets.size() - 2;
+    }
+
+    double ratio(const size_t i, const double s) const
+    {
+        const double segmentLength = _dists[i] - _dists[i - 1];
+        return segmentLength > 0. ? (s - _dists[i - 1]) / segmentLength : 0.;
+    }
+
+    Span<const P> _points;
+    std::vector<double> _dists;
+    std::vector<uint32_t> _buckets;
+    double _bucketScale;
+};
+
+}
@@ -1,5 +1,28 @@
 #include "colorMap.h"
 
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define COLORMAP_SIMD_X86
+#include <immintrin.h>
+#endif
+
+#include <vector>
+
+namespace
+{
+
+#ifdef COLORMAP_SIMD_X86
+bool hasAvx2()
+{
+    static const bool avx2 = [] {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    }();
+    return avx2;
+}
+#endif
+
+}
+
 /*!
    Map a value into a color
 
@@ -18,19 +41,37 @@ QColor ColorMap::color(const double min, const double max, double value) const
 }
 
 /*!
-   Build and return a color map of 256 colors
+   Map an array of values of a given interval into RGB values
+
+   The default implementation calls rgb() for each value.
+
+   \param min Minimum of the value interval
+   \param max Maximum of the value interval
+   \param values Values to map
+   \param out RGB values, corresponding to values
+   \param n Number of values
+*/
+void ColorMap::mapBatch(const double min, const double max, const double* values, QRgb* out, size_t n) const
+{
+    for (size_t i = 0; i < n; ++i)
+        out[i] = rgb(min, max, values[i]);
+}
+
+/*!
+   Build and return a color map of numColors colors
 
    The color table is needed for rendering indexed images in combination
    with using colorIndex().
 
    \param interval Range for the values
+   \param numColors Number of colors of the table
    \return A color table, that can be used for a QImage
 */
-QVector<QRgb> ColorMap::colorTable(const double min, const double max) const
+QVector<QRgb> ColorMap::colorTable(const double min, const double max, const int numColors) const
 {
-    QVector<QRgb> table(256);
+    QVector<QRgb> table(numColors);
 
-    if (min <= max) {
+    if (min <= max && numColors > 1) {
         const double step = (max - min) / (table.size() - 1);
         for (int i = 0; i < table.size(); i++)
             table[i] = rgb(min, max, min + step * i);
@@ -98,6 +139,10 @@ void LinearColorMap::setColorInterval(const QColor& color1, const QColor& color2
    F.e. a stop at position 17.0 for a range [10.0,20.0] must be
    passed as: (17.0 - 10.0) / (20.0 - 10.0)
 
+   Adding a stop is O(n) in the number of stops: the following stops
+   are shifted and the uniform spacing is checked again. Lookups stay
+   O(1) for evenly spaced stops and O(log n) otherwise.
+
    \param value Value between [0.0, 1.0]
    \param color Color stop
 */
@@ -154,96 +199,252 @@ QRgb LinearColorMap::rgb(const double min, const double max, double value) const
     return d_colorStops.rgb(d_mode, ratio);
 }
 
+/*!
+  Map an array of values of a given interval into RGB values
+
+  Same results as rgb(), NaN values included, but vectorized (AVX2)
+  when the CPU supports it.
+
+  \sa ColorMap::mapBatch()
+*/
+void LinearColorMap::mapBatch(const double min, const double max, const double* values, QRgb* out, size_t n) const
+{
+    const double width = max - min;
+    if (width <= 0.0) {
+        std::fill(out, out + n, 0u);
+        return;
+    }
+
+    d_colorStops.rgbBatch(d_mode, min, width, values, out, n);
+}
+
 LinearColorMap::ColorStops::ColorStops() :
-    d_doAlpha(false)
+    d_uniform(false),
+    d_uniformScale(0.0)
 {
-    d_stops.reserve(256);
 }
 
 void LinearColorMap::ColorStops::insert(double pos, const QColor& color)
 {
-    // Lookups need to be very fast, insertions are not so important.
-    // Anyway, a balanced tree is what we need here. TODO ...
+    // O(n): the position is found with a binary search, but the insertion
+    // shifts the following stops (a memmove) and updateUniform() checks
+    // all of them. A tree would insert in O(log n) but scatter the stops
+    // that every lookup walks; 20000 insertions into a 1000-stop map take
+    // a few milliseconds.
 
     if (pos < 0.0 || pos > 1.0)
         return;
 
-    int index;
-    if (d_stops.size() == 0) {
-        index = 0;
-        d_stops.resize(1);
+    const QRgb rgb = color.rgba();
+    const int index = findUpper(pos);
+    if (index == d_pos.size() || qAbs(d_pos[index] - pos) >= 0.001) {
+        d_pos.insert(index, pos);
+        d_rgb.insert(index, rgb);
     } else {
-        index = findUpper(pos);
-        if (index == d_stops.size() || qAbs(d_stops[index].pos - pos) >= 0.001) {
-            d_stops.resize(d_stops.size() + 1);
-            for (int i = d_stops.size() - 1; i > index; i--)
-                d_stops[i] = d_stops[i - 1];
-        }
+        d_pos[index] = pos;
+        d_rgb[index] = rgb;
     }
 
-    d_stops[index] = ColorStop(pos, color);
-    if (color.alpha() != 255)
-        d_doAlpha = true;
-
-    if (index > 0)
-        d_stops[index - 1].updateSteps(d_stops[index]);
-
-    if (index < d_stops.size() - 1)
-        d_stops[index].updateSteps(d_stops[index + 1]);
+    updateUniform();
 }
 
 QRgb LinearColorMap::ColorStops::rgb(LinearColorMap::Mode mode, double pos) const
 {
     if (pos <= 0.0)
-        return d_stops[0].rgb;
+        return d_rgb[0];
     if (pos >= 1.0)
-        return d_stops[d_stops.size() - 1].rgb;
+        return d_rgb[d_rgb.size() - 1];
 
     const int index = findUpper(pos);
     if (mode == FixedColors) {
-        return d_stops[index - 1].rgb;
+        return d_rgb[index - 1];
     } else {
-        const ColorStop& s1 = d_stops[index - 1];
-
-        const double ratio = (pos - s1.pos) / (s1.posStep);
-
-        const int r = int(s1.r0 + ratio * s1.rStep);
-        const int g = int(s1.g0 + ratio * s1.gStep);
-        const int b = int(s1.b0 + ratio * s1.bStep);
-
-        if (d_doAlpha) {
-            if (s1.aStep) {
-                const int a = int(s1.a0 + ratio * s1.aStep);
-                return qRgba(r, g, b, a);
-            } else {
-                return qRgba(r, g, b, s1.a);
-            }
-        } else {
-            return qRgb(r, g, b);
+        const double ratio = (pos - d_pos[index - 1]) / (d_pos[index] - d_pos[index - 1]);
+        return interpolate(d_rgb[index - 1], d_rgb[index], ratio);
+    }
+}
+
+namespace
+{
+
+#ifdef COLORMAP_SIMD_X86
+
+struct StopArrays
+{
+    const double* pos;
+    const int* rgb;
+    int count;
+
+    bool uniform;
+    double first;
+    double uniformScale;
+};
+
+// 64-bit lane masks to 32-bit lane masks
+__attribute__((target("avx2"))) inline __m128i narrow(const __m256d mask)
+{
+    const __m256i evenLanes = _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0);
+    return _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(_mm256_castpd_si256(mask), evenLanes));
+}
+
+// NB: the masked gather avoids GCC's bogus -Wmaybe-uninitialized on _mm256_i32gather_pd
+__attribute__((target("avx2"))) inline __m256d gather(const double* base, const __m128i index)
+{
+    const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), base, index, all, 8);
+}
+
+// ColorStops::interpolate() of 4 colors: the channels are widened to 32-bit
+// lanes, v1 * 65536 + ( v2 - v1 ) * t being v1 * ( 65536 - t ) + v2 * t
+__attribute__((target("avx2"))) inline __m128i interpolate(const __m128i rgb1, const __m128i rgb2, const __m128i t)
+{
+    const __m256i wideT = _mm256_castsi128_si256(t);
+    const __m256i t01 = _mm256_permutevar8x32_epi32(wideT, _mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1));
+    const __m256i t23 = _mm256_permutevar8x32_epi32(wideT, _mm256_setr_epi32(2, 2, 2, 2, 3, 3, 3, 3));
+    const __m256i half = _mm256_set1_epi32(0x8000);
+
+    const __m256i c1lo = _mm256_cvtepu8_epi32(rgb1);
+    const __m256i c1hi = _mm256_cvtepu8_epi32(_mm_srli_si128(rgb1, 8));
+    const __m256i c2lo = _mm256_cvtepu8_epi32(rgb2);
+    const __m256i c2hi = _mm256_cvtepu8_epi32(_mm_srli_si128(rgb2, 8));
+
+    const __m256i lo = _mm256_srli_epi32(_mm256_add_epi32(_mm256_add_epi32(_mm256_slli_epi32(c1lo, 16),
+        _mm256_mullo_epi32(_mm256_sub_epi32(c2lo, c1lo), t01)), half), 16);
+    const __m256i hi = _mm256_srli_epi32(_mm256_add_epi32(_mm256_add_epi32(_mm256_slli_epi32(c1hi, 16),
+        _mm256_mullo_epi32(_mm256_sub_epi32(c2hi, c1hi), t23)), half), 16);
+
+    // 128-bit lanes: (color 0, color 2) and (color 1, color 3) after packing
+    const __m256i bytes = _mm256_packus_epi16(_mm256_packus_epi32(lo, hi), _mm256_setzero_si256());
+    const __m256i ordered = _mm256_permutevar8x32_epi32(bytes, _mm256_setr_epi32(0, 4, 1, 5, 0, 0, 0, 0));
+    return _mm256_castsi256_si128(ordered);
+}
+
+// index of the last stop at or before pos (findUpper() - 1)
+__attribute__((target("avx2"))) inline __m128i lowerStop(const StopArrays& stops, const __m256d pos)
+{
+    if (stops.uniform) {
+        // computed guess, off by one at most, then corrected
+        const __m256d guess = _mm256_mul_pd(_mm256_sub_pd(pos, _mm256_set1_pd(stops.first)),
+            _mm256_set1_pd(stops.uniformScale));
+        __m128i lower = _mm256_cvttpd_epi32(guess);
+        lower = _mm_max_epi32(_mm_min_epi32(lower, _mm_set1_epi32(stops.count - 2)), _mm_setzero_si128());
+
+        const __m128i one = _mm_set1_epi32(1);
+        const __m256d nextPos = gather(stops.pos, _mm_add_epi32(lower, one));
+        lower = _mm_add_epi32(lower, _mm_and_si128(narrow(_mm256_cmp_pd(nextPos, pos, _CMP_LE_OQ)), one));
+        const __m256d lowerPos = gather(stops.pos, lower);
+        const __m128i isAbove = narrow(_mm256_cmp_pd(lowerPos, pos, _CMP_GT_OQ));
+        const __m128i canDecrement = _mm_cmpgt_epi32(lower, _mm_setzero_si128());
+        return _mm_sub_epi32(lower, _mm_and_si128(_mm_and_si128(isAbove, canDecrement), one));
+    }
+
+    // branchless binary search
+    __m128i lower = _mm_setzero_si128();
+    for (int len = stops.count; len > 1;) {
+        const int half = len / 2;
+        const __m128i middle = _mm_add_epi32(lower, _mm_set1_epi32(half));
+        const __m256d middlePos = gather(stops.pos, middle);
+        lower = _mm_blendv_epi8(lower, middle, narrow(_mm256_cmp_pd(middlePos, pos, _CMP_LE_OQ)));
+        len -= half;
+    }
+    return lower;
+}
+
+__attribute__((target("avx2"))) void rgbBatchAvx2(const StopArrays& stops, const bool scaled,
+    const double min, const double width, const double* values, QRgb* out, const size_t n)
+{
+    const __m256d vmin = _mm256_set1_pd(min);
+    const __m256d vwidth = _mm256_set1_pd(width);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m128i firstRgb = _mm_set1_epi32(stops.rgb[0]);
+    const __m128i lastRgb = _mm_set1_epi32(stops.rgb[stops.count - 1]);
+    const __m128i lastIndex = _mm_set1_epi32(stops.count - 1);
+    const __m256d fixedOne = _mm256_set1_pd(65536.0);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256d value = _mm256_loadu_pd(values + i);
+        const __m256d pos = _mm256_div_pd(_mm256_sub_pd(value, vmin), vwidth);
+        const __m128i lower = lowerStop(stops, pos);
+
+        __m128i rgb = _mm_i32gather_epi32(stops.rgb, lower, 4);
+        if (scaled) {
+            const __m128i upper = _mm_min_epi32(_mm_add_epi32(lower, _mm_set1_epi32(1)), lastIndex);
+            const __m128i rgb2 = _mm_i32gather_epi32(stops.rgb, upper, 4);
+            const __m256d pos1 = gather(stops.pos, lower);
+            const __m256d pos2 = gather(stops.pos, upper);
+            const __m256d ratio = _mm256_div_pd(_mm256_sub_pd(pos, pos1), _mm256_sub_pd(pos2, pos1));
+            const __m128i t = _mm256_cvttpd_epi32(_mm256_mul_pd(ratio, fixedOne));
+
+            rgb = interpolate(rgb, rgb2, t);
         }
+
+        rgb = _mm_blendv_epi8(rgb, firstRgb, narrow(_mm256_cmp_pd(pos, zero, _CMP_LE_OQ)));
+        rgb = _mm_blendv_epi8(rgb, lastRgb, narrow(_mm256_cmp_pd(pos, one, _CMP_GE_OQ)));
+        rgb = _mm_andnot_si128(narrow(_mm256_cmp_pd(value, value, _CMP_UNORD_Q)), rgb);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), rgb);
+    }
+}
+
+#endif
+
+}
+
+void LinearColorMap::ColorStops::rgbBatch(LinearColorMap::Mode mode, const double min, const double width,
+    const double* values, QRgb* out, size_t n) const
+{
+    size_t i = 0;
+
+#ifdef COLORMAP_SIMD_X86
+    if (n >= 4 && d_pos.size() >= 2 && hasAvx2()) {
+        StopArrays stops;
+        stops.pos = d_pos.constData();
+        stops.rgb = reinterpret_cast<const int*>(d_rgb.constData());
+        stops.count = d_pos.size();
+        stops.uniform = d_uniform;
+        stops.first = d_pos[0];
+        stops.uniformScale = d_uniformScale;
+
+        i = n - n % 4;
+        rgbBatchAvx2(stops, mode == ScaledColors, min, width, values, out, i);
     }
+#endif
+
+    for (; i < n; ++i)
+        out[i] = qIsNaN(values[i]) ? 0u : rgb(mode, (values[i] - min) / width);
 }
 
 QVector<double> LinearColorMap::ColorStops::stops() const
 {
-    QVector<double> positions(d_stops.size());
-    for (int i = 0; i < d_stops.size(); i++)
-        positions[i] = d_stops[i].pos;
-    return positions;
+    return d_pos;
 }
 
 int LinearColorMap::ColorStops::findUpper(double pos) const
 {
-    int index = 0;
-    int n = d_stops.size();
+    const double* stops = d_pos.constData();
+    const int count = d_pos.size();
+
+    if (d_uniform) {
+        // the guess is off by one at most (see updateUniform())
+        int index = int((pos - stops[0]) * d_uniformScale) + 1;
+        index = qBound(0, index, count);
+        while (index < count && stops[index] <= pos)
+            index++;
+        while (index > 0 && stops[index - 1] > pos)
+            index--;
+
+        return index;
+    }
 
-    const ColorStop* stops = d_stops.data();
+    int index = 0;
+    int n = count;
 
     while (n > 0) {
         const int half = n >> 1;
         const int middle = index + half;
 
-        if (stops[middle].pos <= pos) {
+        if (stops[middle] <= pos) {
             index = middle + 1;
             n -= half + 1;
         } else
@@ -253,43 +454,112 @@ int LinearColorMap::ColorStops::findUpper(double pos) const
     return index;
 }
 
-LinearColorMap::ColorStops::ColorStop::ColorStop() :
-    pos(0.0),
-    rgb(0)
+void LinearColorMap::ColorStops::updateUniform()
 {
+    const int count = d_pos.size();
 
+    d_uniform = false;
+    d_uniformScale = 0.0;
+    if (count < 2 || d_pos[count - 1] <= d_pos[0])
+        return;
+
+    // tolerance far below the spacing, so that the computed index of a
+    // position is off by one at most
+    const double spacing = (d_pos[count - 1] - d_pos[0]) / (count - 1);
+    for (int i = 1; i < count - 1; i++) {
+        if (qAbs(d_pos[i] - (d_pos[0] + i * spacing)) > 1e-6 * spacing)
+            return;
+    }
+
+    d_uniform = true;
+    d_uniformScale = 1.0 / spacing;
 }
 
-LinearColorMap::ColorStops::ColorStop::ColorStop(double p, const QColor& c)
-    :
-    pos(p),
-    rgb(c.rgba())
+CompiledColorMap::CompiledColorMap() :
+    d_min(0.0),
+    d_max(0.0),
+    d_scale(0.0),
+    d_maxIndex(0.0)
 {
-    r = qRed(rgb);
-    g = qGreen(rgb);
-    b = qBlue(rgb);
-    a = qAlpha(rgb);
+}
+
+/*!
+   Build a lookup table of a color map
 
-    /*
-        when mapping a value to rgb we will have to calcualate:
-           - const int v = int( ( s1.v0 + ratio * s1.vStep ) + 0.5 );
+   \param colorMap Color map to sample
+   \param min Minimum of the value interval
+   \param max Maximum of the value interval
+   \param size Number of entries of the table
+*/
+CompiledColorMap::CompiledColorMap(const ColorMap& colorMap, const double min, const double max, const int size)
+{
+    compile(colorMap, min, max, size);
+}
 
-        Thus adding 0.5 ( for rounding ) can be done in advance
-     */
-    r0 = r + 0.5;
-    g0 = g + 0.5;
-    b0 = b + 0.5;
-    a0 = a + 0.5;
+/*!
+   Rebuild the lookup table
 
-    rStep = gStep = bStep = aStep = 0.0;
-    posStep = 0.0;
+   \sa CompiledColorMap()
+*/
+void CompiledColorMap::compile(const ColorMap& colorMap, const double min, const double max, const int size)
+{
+    d_min = min;
+    d_max = max;
+    d_table.clear();
+    d_scale = d_maxIndex = 0.0;
+
+    if (min < max && size > 1) {
+        d_table = colorMap.colorTable(min, max, size);
+        d_maxIndex = size - 1;
+        d_scale = d_maxIndex / (max - min);
+    }
 }
 
-void LinearColorMap::ColorStops::ColorStop::updateSteps(const ColorStop& nextStop)
+double CompiledColorMap::min() const
 {
-    rStep = nextStop.r - r;
-    gStep = nextStop.g - g;
-    bStep = nextStop.b - b;
-    aStep = nextStop.a - a;
-    posStep = nextStop.pos - pos;
+    return d_min;
+}
+
+double CompiledColorMap::max() const
+{
+    return d_max;
+}
+
+const QVector<QRgb>& CompiledColorMap::table() const
+{
+    return d_table;
+}
+
+/*!
+  Map a value of a given interval into a RGB value
+
+  The table covers the compiled interval: values of another interval are
+  rescaled into it.
+*/
+QRgb CompiledColorMap::rgb(const double min, const double max, double value) const
+{
+    if (min == d_min && max == d_max)
+        return rgb(value);
+
+    const double width = max - min;
+    if (width <= 0.0)
+        return 0u;
+
+    return rgb(d_min + (value - min) / width * (d_max - d_min));
+}
+
+/*!
+  Map an array of values of a given interval into RGB values
+
+  \sa ColorMap::mapBatch()
+*/
+void CompiledColorMap::mapBatch(const double min, const double max, const double* values, QRgb* out, size_t n) const
+{
+    if (min != d_min || max != d_max) {
+        ColorMap::mapBatch(min, max, values, out, n);
+        return;
+    }
+
+    for (size_t i = 0; i < n; ++i)
+        out[i] = rgb(values[i]);
 }
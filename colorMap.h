@@ -24,8 +24,10 @@ public:
     */
     virtual QRgb rgb(const double min, const double max, double value) const = 0;
 
+    virtual void mapBatch(const double min, const double max, const double* values, QRgb* out, size_t n) const;
+
     QColor color(const double min, const double max, double value) const;
-    virtual QVector<QRgb> colorTable(const double min, const double max) const;
+    virtual QVector<QRgb> colorTable(const double min, const double max, const int numColors = 256) const;
 };
 
 /*!
@@ -66,6 +68,7 @@ public:
     QColor color2() const;
 
     QRgb rgb(const double min, const double max, double value) const override;
+    void mapBatch(const double min, const double max, const double* values, QRgb* out, size_t n) const override;
 
     class ColorStops
     {
@@ -74,32 +77,104 @@ public:
 
         void insert(double pos, const QColor& color);
         QRgb rgb(LinearColorMap::Mode, double pos) const;
+        void rgbBatch(LinearColorMap::Mode, const double min, const double width,
+                      const double* values, QRgb* out, size_t n) const;
 
         QVector<double> stops() const;
 
-    private:
-        struct ColorStop
+        /*
+            Interpolation of the four channels of c1 and c2 in 16.16 fixed
+            point, ratio being in [0, 1]: the channels are spread in 32-bit
+            fields of two 64-bit words (blue/red and green/alpha) and
+            interpolated at once. The result differs by 1 at most from
+            int( ( v1 + 0.5 ) + ratio * ( v2 - v1 ) ).
+         */
+        static constexpr QRgb interpolate(const QRgb c1, const QRgb c2, const double ratio)
         {
-            ColorStop();
-            ColorStop(double p, const QColor& c);
-            void updateSteps(const ColorStop& nextStop);
+            const quint64 t = quint64(int(ratio * 65536.0));
+            const quint64 mask = 0x000000ff000000ffull;
+            const quint64 half = 0x0000800000008000ull;
+
+            const quint64 rb1 = (quint64(c1 & 0x00ff00ffu) * 0x10001ull) & mask;
+            const quint64 rb2 = (quint64(c2 & 0x00ff00ffu) * 0x10001ull) & mask;
+            const quint64 ag1 = (quint64((c1 >> 8) & 0x00ff00ffu) * 0x10001ull) & mask;
+            const quint64 ag2 = (quint64((c2 >> 8) & 0x00ff00ffu) * 0x10001ull) & mask;
 
-            double pos;
-            QRgb rgb;
-            int r, g, b, a;
+            // v1 * 65536 + ( v2 - v1 ) * t in each field: the fields stay in
+            // [0, 2^24) and the borrows of the differences cancel out
+            const quint64 rb = (((rb1 << 16) + (rb2 - rb1) * t + half) >> 16) & mask;
+            const quint64 ag = (((ag1 << 16) + (ag2 - ag1) * t + half) >> 16) & mask;
 
-            // precalculated values
-            double rStep, gStep, bStep, aStep;
-            double r0, g0, b0, a0;
-            double posStep;
-        };
+            return QRgb(rb | (rb >> 16)) | (QRgb(ag | (ag >> 16)) << 8);
+        }
 
+    private:
         int findUpper(double pos) const;
-        QVector<ColorStop> d_stops;
-        bool d_doAlpha;
+        void updateUniform();
+
+        // sorted by position, structure of arrays: 12 bytes per stop
+        QVector<double> d_pos;
+        QVector<QRgb> d_rgb;
+
+        // evenly spaced stops: the stop of a position is computed, not searched
+        bool d_uniform;
+        double d_uniformScale;
     };
 
 private:
     ColorStops d_colorStops;
     Mode d_mode;
 };
+
+/*!
+  \brief CompiledColorMap bakes a color map into a lookup table.
+
+  The colors of a color map are sampled once for a given interval,
+  then mapping a value is a multiply, a clamp and a load.
+
+  The value is rounded to the nearest table entry, i.e. moved by at most
+  half a table step: (max - min) / (2 * (size - 1)). For a LinearColorMap
+  in ScaledColors mode, the error of a channel is thus bounded by
+  maxSlope / (2 * (size - 1)) + 1 LSB (rounding), where maxSlope is
+  the largest |channel difference / position difference| between two
+  adjacent stops (f.e. 1275 for Jet: 0.2 between stops). With the
+  default 4096 entries, this is at most 1 LSB for all the presets. With
+  256 entries it can reach 3 LSB for Jet.
+  In FixedColors mode only the values within half a step of a stop can
+  get the color of the neighbouring stop.
+*/
+class CompiledColorMap : public ColorMap
+{
+public:
+    CompiledColorMap();
+    CompiledColorMap(const ColorMap& colorMap, const double min, const double max, const int size = 4096);
+
+    void compile(const ColorMap& colorMap, const double min, const double max, const int size = 4096);
+
+    double min() const;
+    double max() const;
+    const QVector<QRgb>& table() const;
+
+    /*!
+       Map a value of the compiled interval into a RGB value.
+    */
+    inline QRgb rgb(double value) const
+    {
+        if (qIsNaN(value) || d_table.isEmpty())
+            return 0u;
+
+        double index = (value - d_min) * d_scale;
+        index = index < 0.0 ? 0.0 : (index > d_maxIndex ? d_maxIndex : index);
+        return d_table.data()[int(index + 0.5)];
+    }
+
+    QRgb rgb(const double min, const double max, double value) const override;
+    void mapBatch(const double min, const double max, const double* values, QRgb* out, size_t n) const override;
+
+private:
+    QVector<QRgb> d_table;
+    double d_min;
+    double d_max;
+    double d_scale;
+    double d_maxIndex;
+};
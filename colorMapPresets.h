@@ -23,4 +23,157 @@ ControlPoints Jet();
 ControlPoints Grayscale();
 ControlPoints XRay();
 
+/* Compile-time presets: same control points as the functions above, as
+ * constexpr tables usable with StaticLinearColorMap.
+ */
+struct StaticControlPoint
+{
+    double x, r, g, b;
+};
+
+struct BlackBodyRadiationTable
+{
+    static constexpr StaticControlPoint points[] = {
+        { 0,   0,              0,              0 },
+        { 0.4, 0.901960784314, 0,              0 },
+        { 0.8, 0.901960784314, 0.901960784314, 0 },
+        { 1,   1,              1,              1 } };
+};
+
+struct CoolToWarmTable
+{
+    static constexpr StaticControlPoint points[] = {
+        { 0,   0.23137254902000001, 0.298039215686,       0.75294117647100001 },
+        { 0.5, 0.86499999999999999, 0.86499999999999999,  0.86499999999999999 },
+        { 1,   0.70588235294099999, 0.015686274509800001, 0.149019607843 } };
+};
+
+// Qt::darkBlue, Qt::blue, Qt::cyan, Qt::yellow, Qt::red, Qt::darkRed
+struct JetTable
+{
+    static constexpr StaticControlPoint points[] = {
+        { 0.0, 0,           0,           128 / 255. },
+        { 0.2, 0,           0,           1 },
+        { 0.4, 0,           1,           1 },
+        { 0.6, 1,           1,           0 },
+        { 0.8, 1,           0,           0 },
+        { 1.0, 128 / 255.,  0,           0 } };
+};
+
+struct GrayscaleTable
+{
+    static constexpr StaticControlPoint points[] = {
+        { 0, 0, 0, 0 },
+        { 1, 1, 1, 1 } };
+};
+
+struct XRayTable
+{
+    static constexpr StaticControlPoint points[] = {
+        { 0, 1, 1, 1 },
+        { 1, 0, 0, 0 } };
+};
+
+namespace detail
+{
+
+template <typename Table>
+constexpr int pointsCount()
+{
+    return int(sizeof(Table::points) / sizeof(StaticControlPoint));
+}
+
+// 8-bit channel of a color set with QColor::setRgbF() (16-bit components)
+constexpr int channel(const double f)
+{
+    const int c = int(f * 65535 + 0.5);
+    return (c - (c >> 8) + 0x80) >> 8;
+}
+
+template <typename Table>
+constexpr QRgb stopRgb(const int i)
+{
+    return qRgb(channel(Table::points[i].r), channel(Table::points[i].g), channel(Table::points[i].b));
+}
+
+// LinearColorMap::rgb() in ScaledColors mode, for a position in [0, 1]
+template <typename Table>
+constexpr QRgb rgb(const double pos)
+{
+    const int count = pointsCount<Table>();
+    if (pos <= 0.0)
+        return stopRgb<Table>(0);
+    if (pos >= 1.0)
+        return stopRgb<Table>(count - 1);
+
+    int index = 1;
+    while (index < count - 1 && Table::points[index].x <= pos)
+        index++;
+
+    const double ratio = (pos - Table::points[index - 1].x) / (Table::points[index].x - Table::points[index - 1].x);
+    return LinearColorMap::ColorStops::interpolate(stopRgb<Table>(index - 1), stopRgb<Table>(index), ratio);
+}
+
+template <int Size>
+struct ColorTable
+{
+    QRgb values[Size];
+};
+
+template <typename Table, int Size>
+constexpr ColorTable<Size> colorTable()
+{
+    ColorTable<Size> table = {};
+    const double step = 1.0 / (Size - 1);
+    for (int i = 0; i < Size; i++)
+        table.values[i] = rgb<Table>(step * i);
+    return table;
+}
+
+}
+
+/* Color map of a compile-time preset, with its lookup table computed by the
+ * compiler: no construction cost and a non-virtual, inlinable rgb().
+ *
+ * The table holds the same colors as CompiledColorMap(LinearColorMap of the
+ * preset, 0, 1, Size), so the same error bound applies.
+ */
+template <typename Table, int Size = 4096>
+class StaticLinearColorMap
+{
+    static_assert(Size > 1, "a color table needs 2 entries at least");
+
+public:
+    constexpr StaticLinearColorMap(const double min = 0.0, const double max = 1.0) :
+        d_min(min),
+        d_scale(max > min ? (Size - 1) / (max - min) : 0.0)
+    {
+    }
+
+    /*!
+       Map a value of the interval into a RGB value.
+    */
+    inline QRgb rgb(double value) const
+    {
+        if (qIsNaN(value) || d_scale == 0.0)
+            return 0u;
+
+        double index = (value - d_min) * d_scale;
+        index = index < 0.0 ? 0.0 : (index > Size - 1 ? Size - 1 : index);
+        return s_table.values[int(index + 0.5)];
+    }
+
+    static constexpr int size() { return Size; }
+    static constexpr QRgb tableEntry(const int i) { return s_table.values[i]; }
+
+private:
+    static constexpr detail::ColorTable<Size> s_table = detail::colorTable<Table, Size>();
+
+    double d_min;
+    double d_scale;
+};
+
+template <typename Table, int Size>
+constexpr detail::ColorTable<Size> StaticLinearColorMap<Table, Size>::s_table;
+
 }
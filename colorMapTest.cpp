@@ -0,0 +1,184 @@
+#include "colorMap.h"
+#include "colorMapPresets.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+/* Validates the fixed point interpolation of LinearColorMap against the double
+ * arithmetic it replaced, int( ( v1 + 0.5 ) + ratio * ( v2 - v1 ) ):
+ * - ColorStops::interpolate() on every pair of channel values, for 257 evenly
+ *   spaced ratios and 200 random ones: 1 LSB of difference at most;
+ * - rgb() in ScaledColors mode on a translucent 300-stop map: 1 LSB at most;
+ * - mapBatch() (AVX2 kernel on the CPUs that have it) bit-identical to rgb(),
+ *   in both modes, for the presets and the 300-stop map, out of range and
+ *   NaN values included.
+ * Returns non-zero on failure.
+ */
+
+namespace
+{
+
+int reference(const int v1, const int v2, const double ratio)
+{
+    return int((v1 + 0.5) + ratio * (v2 - v1));
+}
+
+int g_failures = 0;
+
+// every channel gets every pair (v1, v2): blue (v1, v2), green (v2, v1),
+// red (255 - v1, v2), alpha (v1, 255 - v2)
+void checkInterpolate()
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> random(0., 1.);
+    std::vector<double> ratios;
+    for (int i = 0; i <= 256; ++i)
+        ratios.push_back(i / 256.);
+    for (int i = 0; i < 200; ++i)
+        ratios.push_back(random(rng));
+
+    int maxDifference = 0;
+    size_t differing = 0;
+    for (int v1 = 0; v1 < 256; ++v1)
+        for (int v2 = 0; v2 < 256; ++v2)
+        {
+            const QRgb c1 = qRgba(255 - v1, v2, v1, v1);
+            const QRgb c2 = qRgba(v2, v1, v2, 255 - v2);
+            for (const double ratio : ratios)
+            {
+                const QRgb c = LinearColorMap::ColorStops::interpolate(c1, c2, ratio);
+                const int differences[] = {
+                    std::abs(qBlue(c) - reference(v1, v2, ratio)),
+                    std::abs(qGreen(c) - reference(v2, v1, ratio)),
+                    std::abs(qRed(c) - reference(255 - v1, v2, ratio)),
+                    std::abs(qAlpha(c) - reference(v1, 255 - v2, ratio)) };
+                const int difference = *std::max_element(differences, differences + 4);
+                maxDifference = std::max(maxDifference, difference);
+                differing += difference != 0;
+            }
+        }
+
+    std::printf("interpolate(): %zu of %zu colors differ from the double path, by %d LSB at most\n", differing,
+        size_t(256 * 256) * ratios.size(), maxDifference);
+    if (maxDifference > 1)
+    {
+        std::fprintf(stderr, "FAIL interpolate(): %d LSB of difference\n", maxDifference);
+        ++g_failures;
+    }
+}
+
+struct Stop
+{
+    double pos;
+    QRgb rgb;
+};
+
+// rgb() in ScaledColors mode against the double path, positions in [0, 1]
+void checkScaledRgb(const LinearColorMap& colorMap, const std::vector<Stop>& stops)
+{
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> random(0., 1.);
+    int maxDifference = 0;
+    for (int i = 0; i < 1000000; ++i)
+    {
+        const double pos = random(rng);
+        const size_t upper = size_t(std::upper_bound(stops.begin(), stops.end(), pos,
+            [](const double p, const Stop& stop) { return p < stop.pos; }) - stops.begin());
+        const Stop& s1 = stops[upper - 1];
+        const Stop& s2 = stops[std::min(upper, stops.size() - 1)];
+        const double ratio = upper < stops.size() ? (pos - s1.pos) / (s2.pos - s1.pos) : 0.;
+
+        const QRgb c = colorMap.rgb(0., 1., pos);
+        const int differences[] = {
+            std::abs(qRed(c) - reference(qRed(s1.rgb), qRed(s2.rgb), ratio)),
+            std::abs(qGreen(c) - reference(qGreen(s1.rgb), qGreen(s2.rgb), ratio)),
+            std::abs(qBlue(c) - reference(qBlue(s1.rgb), qBlue(s2.rgb), ratio)),
+            std::abs(qAlpha(c) - reference(qAlpha(s1.rgb), qAlpha(s2.rgb), ratio)) };
+        maxDifference = std::max(maxDifference, *std::max_element(differences, differences + 4));
+    }
+
+    if (maxDifference > 1)
+    {
+        std::fprintf(stderr, "FAIL rgb(): %d LSB of difference with the double path\n", maxDifference);
+        ++g_failures;
+    }
+}
+
+// mapBatch() against rgb(), values in [min - width / 4, max + width / 4] and NaN
+void checkMapBatch(const char* name, const LinearColorMap& colorMap)
+{
+    const double min = -3.;
+    const double max = 5.;
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<double> random(min - 2., max + 2.);
+    std::vector<double> values(200003);
+    for (size_t i = 0; i < values.size(); ++i)
+        values[i] = i % 97 == 0 ? std::nan("") : (i % 89 == 0 ? (i % 2 ? min : max) : random(rng));
+
+    std::vector<QRgb> batch(values.size());
+    colorMap.mapBatch(min, max, values.data(), batch.data(), batch.size());
+    size_t differing = 0;
+    for (size_t i = 0; i < values.size(); ++i)
+        differing += batch[i] != colorMap.rgb(min, max, values[i]);
+
+    if (differing != 0)
+    {
+        std::fprintf(stderr, "FAIL mapBatch() of %s, %s: %zu colors differ from rgb()\n", name,
+            colorMap.mode() == LinearColorMap::ScaledColors ? "ScaledColors" : "FixedColors", differing);
+        ++g_failures;
+    }
+}
+
+}
+
+int main()
+{
+    checkInterpolate();
+
+    // translucent map, 300 stops at random positions
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<int> channel(0, 255);
+    std::uniform_real_distribution<double> position(0.001, 0.999);
+    const QColor first(channel(rng), channel(rng), channel(rng), channel(rng));
+    const QColor last(channel(rng), channel(rng), channel(rng), channel(rng));
+    LinearColorMap translucent(first, last);
+    for (int i = 0; i < 298; ++i)
+        translucent.addColorStop(position(rng), QColor(channel(rng), channel(rng), channel(rng), channel(rng)));
+    translucent.setMode(LinearColorMap::ScaledColors);
+
+    // the stops as stored (a stop close to another one replaces it)
+    std::vector<Stop> stops;
+    for (const double pos : translucent.colorStops())
+    {
+        const Stop stop = { pos, 0u };
+        stops.push_back(stop);
+    }
+    for (Stop& stop : stops)
+        stop.rgb = translucent.rgb(0., 1., stop.pos);
+    checkScaledRgb(translucent, stops);
+
+    const std::pair<const char*, ColorMapPresets::ControlPoints> presets[] = {
+        { "BlackBodyRadiation", ColorMapPresets::BlackBodyRadiation() },
+        { "CoolToWarm", ColorMapPresets::CoolToWarm() },
+        { "Jet", ColorMapPresets::Jet() },
+        { "Grayscale", ColorMapPresets::Grayscale() },
+        { "XRay", ColorMapPresets::XRay() } };
+    for (const LinearColorMap::Mode mode : { LinearColorMap::ScaledColors, LinearColorMap::FixedColors })
+    {
+        for (const auto& preset : presets)
+        {
+            LinearColorMap colorMap = ColorMapPresets::controlPointsToLinearColorMap(preset.second);
+            colorMap.setMode(mode);
+            checkMapBatch(preset.first, colorMap);
+        }
+        translucent.setMode(mode);
+        checkMapBatch("the 300-stop map", translucent);
+    }
+
+    std::printf("%d failure(s)\n", g_failures);
+    return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "lineSplitter.h"
+
+#include <cmath>
+
+namespace LineSplitter
+{
+
+enum class Aggregate
+{
+    Min,
+    Max,
+    Mean
+};
+
+/* Multi-resolution pyramid over the data mapped to the segments: node i of
+ * level l aggregates the values [i * 2^l, (i + 1) * 2^l) (the last node of a
+ * level may be shorter). Level 0 is the data itself.
+ *
+ * Built once in O(n) (about 3n extra values), then any node is read in O(1):
+ * drawing the data decimated by 2^l costs O(n / 2^l) whatever n is.
+ *
+ * The pyramid doesn't copy the data: it must outlive it. NaN values are
+ * ignored by Min and Max, they propagate to Mean.
+ */
+class DataPyramid
+{
+public:
+    DataPyramid() {}
+
+    explicit DataPyramid(Span<const double> data)
+    {
+        build(data);
+    }
+
+    void build(Span<const double> data)
+    {
+        _data = data;
+        _levels.clear();
+
+        size_t count = data.size;
+        while (count > 1)
+        {
+            const size_t parentCount = (count + 1) / 2;
+            Level parent;
+            parent.min.resize(parentCount);
+            parent.max.resize(parentCount);
+            parent.sum.resize(parentCount);
+
+            for (size_t i = 0; i < parentCount; ++i)
+            {
+                const size_t first = 2 * i;
+                const size_t second = std::min(first + 1, count - 1);
+                parent.min[i] = std::fmin(nodeValue(_levels.size(), first, Aggregate::Min),
+                                          nodeValue(_levels.size(), second, Aggregate::Min));
+                parent.max[i] = std::fmax(nodeValue(_levels.size(), first, Aggregate::Max),
+                                          nodeValue(_levels.size(), second, Aggregate::Max));
+                parent.sum[i] = nodeSum(_levels.size(), first) + (second != first ? nodeSum(_levels.size(), second) : 0.);
+            }
+
+            _levels.push_back(std::move(parent));
+            count = parentCount;
+        }
+    }
+
+    size_t dataCount() const { return _data.size; }
+    size_t levelCount() const { return _data.empty() ? 0 : _levels.size() + 1; }
+
+    /* Number of nodes of a level. */
+    size_t size(const size_t level) const
+    {
+        return level == 0 ? _data.size : _levels[level - 1].min.size();
+    }
+
+    /* Aggregate of the values of node i of a level. */
+    double value(const size_t level, const size_t i, const Aggregate aggregate) const
+    {
+        if (aggregate != Aggregate::Mean)
+            return nodeValue(level, i, aggregate);
+
+        const size_t first = i << level;
+        const size_t last = std::min(first + (size_t(1) << level), _data.size);
+        return nodeSum(level, i) / double(last - first);
+    }
+
+    /* Smallest level whose nodes aggregate 'groupSize' values or more
+     * (clamped to the top level). */
+    size_t levelFor(const double groupSize) const
+    {
+        size_t level = 0;
+        while (level + 1 < levelCount() && double(size_t(1) << level) < groupSize)
+            ++level;
+        return level;
+    }
+
+private:
+    double nodeValue(const size_t level, const size_t i, const Aggregate aggregate) const
+    {
+        if (level == 0)
+            return _data[i];
+        return aggregate == Aggregate::Min ? _levels[level - 1].min[i] : _levels[level - 1].max[i];
+    }
+
+    double nodeSum(const size_t level, const size_t i) const
+    {
+        return level == 0 ? _data[i] : _levels[level - 1].sum[i];
+    }
+
+    struct Level
+    {
+        std::vector<double> min;
+        std::vector<double> max;
+        std::vector<double> sum;
+    };
+
+    Span<const double> _data;
+    std::vector<Level> _levels; // levels 1, 2...
+};
+
+/* Decimates the segments joining 'points' (segment i mapped to data[i]) by
+ * 2^level: the coarse segment j joins points[j * 2^level] to
+ * points[(j + 1) * 2^level] (or the last point) and gets the aggregate of
+ * its data. 'outputPoints' must hold pyramid.size(level) + 1 points and
+ * 'outputValues' pyramid.size(level) values.
+ *
+ * Returns the number of coarse segments (0 if points doesn't hold
+ * pyramid.dataCount() + 1 points or more, or if the outputs are too small).
+ */
+template <typename P>
+size_t decimateSegments(Span<const typename NonDeduced<P>::type> points, const DataPyramid& pyramid,
+    const size_t level, const Aggregate aggregate, Span<P> outputPoints, Span<double> outputValues)
+{
+    const size_t dataCount = pyramid.dataCount();
+    if (dataCount == 0 || level >= pyramid.levelCount() || points.size < dataCount + 1)
+        return 0;
+
+    const size_t count = pyramid.size(level);
+    if (outputPoints.size < count + 1 || outputValues.size < count)
+        return 0;
+
+    for (size_t j = 0; j < count; ++j)
+    {
+        outputPoints[j] = points[j << level];
+        outputValues[j] = pyramid.value(level, j, aggregate);
+    }
+    outputPoints[count] = points[dataCount];
+
+    return count;
+}
+
+}
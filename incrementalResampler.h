@@ -0,0 +1,113 @@
+#pragma once
+
+#include "lineSplitter.h"
+
+namespace LineSplitter
+{
+
+/* Resamples a polyline that grows one vertex at a time (GPS tracks...)
+ * with samples every 'spacing' along the track.
+ *
+ * Only the running length and the last vertex/sample are kept, so appending a
+ * vertex costs O(1) plus the number of samples it produces, whatever the
+ * length of the track. Sample k lies at the distance k * spacing from the
+ * first vertex (no accumulation of the spacing).
+ */
+template <typename P>
+class IncrementalResampler
+{
+public:
+    explicit IncrementalResampler(const double spacing) :
+        _spacing(spacing)
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        _length = 0.;
+        _vertexCount = 0;
+        _sampleCount = 0;
+    }
+
+    double spacing() const { return _spacing; }
+    double length() const { return _length; }
+    size_t vertexCount() const { return _vertexCount; }
+    size_t sampleCount() const { return _sampleCount; }
+
+    /* Appends a vertex to the track. The new samples are appended to
+     * 'samples' and, if not null, the segments joining them (the first one
+     * starting from the previously emitted sample) to 'segments'.
+     *
+     * Returns the number of new samples.
+     */
+    size_t append(const P& vertex, std::vector<P>& samples, std::vector<Segment<P> >* segments = nullptr)
+    {
+        typedef PointTraits<P> Traits;
+        typedef typename Traits::Scalar Scalar;
+
+        if (_vertexCount++ == 0)
+        {
+            _lastVertex = vertex;
+            emit(vertex, samples, segments);
+            return 1;
+        }
+
+        const double segmentLength = distance(_lastVertex, vertex);
+        const double start = _length;
+        const double end = _length + segmentLength;
+        size_t count = 0;
+
+        if (_spacing > 0. && segmentLength > 0.)
+        {
+            for (double s = _sampleCount * _spacing; s <= end; s = _sampleCount * _spacing)
+            {
+                const double t = (s - start) / segmentLength;
+                emit(Traits::make(Scalar((1 - t) * Traits::x(_lastVertex) + t * Traits::x(vertex)),
+                                  Scalar((1 - t) * Traits::y(_lastVertex) + t * Traits::y(vertex))),
+                     samples, segments);
+                ++count;
+            }
+        }
+
+        _length = end;
+        _lastVertex = vertex;
+        return count;
+    }
+
+    /* Ends the track: emits the last vertex as a final sample if the track
+     * doesn't end on a sample. Call reset() before appending again.
+     * Returns the number of new samples (0 or 1). */
+    size_t finish(std::vector<P>& samples, std::vector<Segment<P> >* segments = nullptr)
+    {
+        if (_vertexCount < 2 || (_sampleCount - 1) * _spacing >= _length)
+            return 0;
+
+        emit(_lastVertex, samples, segments);
+        return 1;
+    }
+
+private:
+    void emit(const P& sample, std::vector<P>& samples, std::vector<Segment<P> >* segments)
+    {
+        if (segments && _sampleCount > 0)
+        {
+            Segment<P> segment;
+            segment.p1 = _lastSample;
+            segment.p2 = sample;
+            segments->push_back(segment);
+        }
+        samples.push_back(sample);
+        _lastSample = sample;
+        ++_sampleCount;
+    }
+
+    double _spacing;
+    double _length;
+    size_t _vertexCount;
+    size_t _sampleCount;
+    P _lastVertex;
+    P _lastSample;
+};
+
+}
@@ -0,0 +1,568 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+/* Qt-free, header-only implementation of the polyline splitters.
+ *
+ * The functions only need a point type and contiguous buffers, so they can be
+ * used by headless tools without pulling in Qt. The GUI wraps them in
+ * createNewPointsAndLinesForData() and lightxbulbCode() (see mainwindow.cpp).
+ */
+namespace LineSplitter
+{
+
+template <typename T>
+struct Point2
+{
+    T x;
+    T y;
+};
+
+/* Specialize this for point types that don't expose public 'x' and 'y'
+ * members (e.g. QPointF). */
+template <typename P>
+struct PointTraits
+{
+    typedef decltype(P::x) Scalar;
+
+    static Scalar x(const P& p) { return p.x; }
+    static Scalar y(const P& p) { return p.y; }
+    static P make(Scalar x, Scalar y)
+    {
+        P p;
+        p.x = x;
+        p.y = y;
+        return p;
+    }
+};
+
+/* Non-owning view over a contiguous buffer (a poor man's std::span). */
+template <typename T>
+struct Span
+{
+    Span() : data(nullptr), size(0) {}
+    Span(T* d, size_t n) : data(d), size(n) {}
+    template <typename U,
+              typename = typename std::enable_if<std::is_convertible<U*, T*>::value>::type>
+    Span(const Span<U>& other) : data(other.data), size(other.size) {}
+
+    T& operator[](size_t i) const { return data[i]; }
+    T* begin() const { return data; }
+    T* end() const { return data + size; }
+    bool empty() const { return size == 0; }
+
+    T* data;
+    size_t size;
+};
+
+template <typename T>
+Span<T> makeSpan(std::vector<T>& v)
+{
+    return Span<T>(v.data(), v.size());
+}
+
+template <typename T>
+Span<const T> makeSpan(const std::vector<T>& v)
+{
+    return Span<const T>(v.data(), v.size());
+}
+
+// Keeps a parameter out of template argument deduction, so that a Span<P>
+// can be passed where a Span<const P> input is expected.
+template <typename T>
+struct NonDeduced
+{
+    typedef T type;
+};
+
+template <typename P>
+struct Segment
+{
+    P p1;
+    P p2;
+};
+
+template <typename P>
+inline double distance(const P& a, const P& b)
+{
+    typedef PointTraits<P> Traits;
+    const double dx = double(Traits::x(b)) - double(Traits::x(a));
+    const double dy = double(Traits::y(b)) - double(Traits::y(a));
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+/* Length of the lines between the points p1 and p2. If p1 > p2, the points
+ * are a closed ring: the lines go from p1 to the last point, back to the
+ * first one and on to p2 (see ringResampler.h for O(1) queries). */
+template <typename P>
+double linesLengthBetween2Points(Span<const P> points, const size_t p1, const size_t p2)
+{
+    double length = 0.;
+    if (p1 >= points.size || p2 >= points.size || p1 == p2)
+        return length;
+
+    if (p1 > p2)
+    {
+        for (size_t i = p1; i < points.size - 1; ++i)
+            length += distance(points[i], points[i + 1]);
+        length += distance(points[points.size - 1], points[0]);
+        for (size_t i = 0; i < p2; ++i)
+            length += distance(points[i], points[i + 1]);
+        return length;
+    }
+
+    for (size_t i = p1; i < p2; ++i)
+        length += distance(points[i], points[i + 1]);
+
+    return length;
+}
+
+template <typename Real>
+class PlainSum
+{
+public:
+    PlainSum() : _sum(0) {}
+
+    void add(const double value) { _sum = _sum + Real(value); }
+    Real value() const { return _sum; }
+
+private:
+    Real _sum;
+};
+
+/* Kahan summation: the rounding error of every addition is subtracted from
+ * the next term, so the sum doesn't drift with the number of terms.
+ * NB: Neumaier's variant accumulates the errors apart, which in float loses
+ * the correction when they are biased (e.g. the same length added 1e6 times). */
+template <typename Real>
+class CompensatedSum
+{
+public:
+    CompensatedSum() : _sum(0), _compensation(0) {}
+
+    void add(const double value)
+    {
+        const Real y = Real(value) - _compensation;
+        const Real t = _sum + y;
+        _compensation = (t - _sum) - y;
+        _sum = t;
+    }
+    Real value() const { return _sum; }
+
+private:
+    Real _sum;
+    Real _compensation;
+};
+
+/* Precision policies of the cumulative distances used by the arc-length
+ * resampler: the type they are stored in and how they are summed.
+ *
+ * FloatPrecision is the cheapest but drifts on long polylines (~1e6 vertices),
+ * which collapses the last output segments. CompensatedPrecision keeps float
+ * storage with a compensated (Kahan) sum, so the distances don't drift,
+ * DoublePrecision doubles the scratch memory.
+ */
+struct FloatPrecision
+{
+    typedef float Real;
+    typedef PlainSum<float> Sum;
+};
+
+struct DoublePrecision
+{
+    typedef double Real;
+    typedef PlainSum<double> Sum;
+};
+
+struct CompensatedPrecision
+{
+    typedef float Real;
+    typedef CompensatedSum<float> Sum;
+};
+
+/* dists[i] = length of the lines between points[0] and points[i].
+ * 'dists' must hold points.size elements. */
+template <typename P, typename Precision = FloatPrecision>
+void cumulativeDistances(Span<const typename NonDeduced<P>::type> points, typename Precision::Real* dists)
+{
+    if (points.empty())
+        return;
+
+    typename Precision::Sum sum;
+    dists[0] = 0;
+    for (size_t i = 1; i < points.size; ++i)
+    {
+        sum.add(distance(points[i], points[i - 1]));
+        dists[i] = sum.value();
+    }
+}
+
+/* Number of points produced by the splitters for 'dataCount' data,
+ * i.e. the capacity the output buffer must have. */
+inline size_t outputPointsCount(const int dataCount)
+{
+    return dataCount > 0 ? size_t(dataCount) + 1 : 0;
+}
+
+/* Step between two output points of resampleArcLength(): length / dataCount,
+ * so that the dataCount output segments have the same length and the last
+ * output point is the last vertex. (It used to be length / (dataCount - 1),
+ * which put point dataCount - 1 on the last vertex and collapsed the last
+ * segment.) */
+template <typename Real>
+Real arcLengthStep(Span<const Real> dists, const int dataCount)
+{
+    return dists[dists.size - 1] / dataCount;
+}
+
+/* Computes the output points [first, last) of resampleArcLength() from the
+ * cumulative distances of 'input'. Output point i lies at the distance i * step,
+ * so any range can be computed independently of the others (and in parallel)
+ * with the same result. A polyline of length 0 outputs input[0] everywhere.
+ */
+template <typename P, typename Real>
+void resampleArcLengthRange(Span<const typename NonDeduced<P>::type> input,
+    Span<const Real> dists,
+    const Real step,
+    size_t first,
+    const size_t last,
+    P* output)
+{
+    typedef PointTraits<P> Traits;
+    typedef typename Traits::Scalar Scalar;
+
+    if (first == 0 && last > 0)
+        output[first++] = input[0];
+    if (first >= last)
+        return;
+
+    // all the points are the same (step = 0): nothing to interpolate along
+    if (!(dists[dists.size - 1] > 0))
+    {
+        for (; first < last; ++first)
+            output[first] = input[0];
+        return;
+    }
+
+    // first segment whose end is at or beyond the first output distance
+    size_t segment_idx = size_t(std::lower_bound(dists.begin() + 1, dists.end(), Real(first) * step) - dists.begin());
+    size_t i;
+    for (i = first; i < last; ++i)
+    {
+        const Real total_dist = Real(i) * step;
+        while (segment_idx < input.size && total_dist > dists[segment_idx])
+            ++segment_idx;
+        if (segment_idx == input.size)
+            break;
+
+        const Real t = (total_dist - dists[segment_idx - 1]) / (dists[segment_idx] - dists[segment_idx - 1]);
+        const double u = double(1 - t);
+        const P& a = input[segment_idx - 1];
+        const P& b = input[segment_idx];
+        output[i] = Traits::make(Scalar(u * Traits::x(a) + t * Traits::x(b)),
+                                 Scalar(u * Traits::y(a) + t * Traits::y(b)));
+    }
+
+    // rounding may overshoot the total length: pad with the last point
+    for (; i < last; ++i)
+        output[i] = input[input.size - 1];
+}
+
+/* Arc-length parametrization (lightxbulb's algorithm): outputs dataCount + 1
+ * points along 'input', point i at the distance i * length / dataCount from
+ * the first vertex: point 0 is the first vertex, point dataCount the last one
+ * (exactly when the float sum overshoots the length, within its rounding
+ * error otherwise). 'dists' is a scratch buffer of input.size elements.
+ *
+ * Returns the number of points written (0 if the input is invalid or the
+ * output buffer too small). A polyline of length 0 outputs input[0]
+ * everywhere.
+ */
+template <typename P, typename Precision = FloatPrecision>
+size_t resampleArcLength(Span<const typename NonDeduced<P>::type> input, const int dataCount, Span<P> output,
+    Span<typename Precision::Real> dists)
+{
+    typedef typename Precision::Real Real;
+
+    const size_t outputCount = outputPointsCount(dataCount);
+    if (input.size < 2 || outputCount == 0 || output.size < outputCount || dists.size < input.size)
+        return 0;
+
+    const Span<const Real> inputDists(dists.data, input.size);
+    cumulativeDistances<P, Precision>(input, dists.data);
+    resampleArcLengthRange<P, Real>(input, inputDists, arcLengthStep(inputDists, dataCount), 0, outputCount, output.data);
+
+    return outputCount;
+}
+
+template <typename P, typename Precision = FloatPrecision>
+size_t resampleArcLength(Span<const typename NonDeduced<P>::type> input, const int dataCount, Span<P> output)
+{
+    std::vector<typename Precision::Real> dists(input.size);
+    return resampleArcLength<P, Precision>(input, dataCount, output, makeSpan(dists));
+}
+
+/* Weighted arc-length parametrization: outputs weights.size + 1 points along
+ * 'input', output segment i having a length proportional to weights[i] (e.g.
+ * the duration of sample i) instead of all the same length. Output point i
+ * lies at the distance length * (weights[0] + ... + weights[i - 1]) / total.
+ *
+ * The split distances are increasing, so they are merged with the cumulative
+ * distances in a single sweep: O(input.size + weights.size), no search.
+ * 'dists' is a scratch buffer of input.size elements.
+ *
+ * Returns the number of points written (0 if the input is invalid, a weight
+ * is negative or not finite, the weights sum to 0, or the output buffer is
+ * too small).
+ */
+template <typename P, typename Precision = FloatPrecision>
+size_t resampleWeighted(Span<const typename NonDeduced<P>::type> input, Span<const double> weights, Span<P> output,
+    Span<typename Precision::Real> dists)
+{
+    typedef PointTraits<P> Traits;
+    typedef typename Traits::Scalar Scalar;
+    typedef typename Precision::Real Real;
+
+    const size_t outputCount = weights.empty() ? 0 : weights.size + 1;
+    if (input.size < 2 || outputCount == 0 || output.size < outputCount || dists.size < input.size)
+        return 0;
+
+    double totalWeight = 0.;
+    for (const double weight : weights)
+    {
+        if (!(weight >= 0.) || !std::isfinite(weight))
+            return 0;
+        totalWeight += weight;
+    }
+    if (!(totalWeight > 0.) || !std::isfinite(totalWeight))
+        return 0;
+
+    cumulativeDistances<P, Precision>(input, dists.data);
+    const double scale = double(dists[input.size - 1]) / totalWeight;
+
+    output[0] = input[0];
+    double weight = 0.; // summed in the same order as totalWeight: the last split is the whole length
+    size_t segment_idx = 1;
+    for (size_t i = 1; i < weights.size; ++i)
+    {
+        weight += weights[i - 1];
+        const Real total_dist = Real(weight * scale);
+        while (segment_idx < input.size - 1 && total_dist > dists[segment_idx])
+            ++segment_idx;
+
+        const Real segmentLength = dists[segment_idx] - dists[segment_idx - 1];
+        Real t = segmentLength > 0 ? (total_dist - dists[segment_idx - 1]) / segmentLength : Real(1);
+        t = t < 0 ? Real(0) : (t > 1 ? Real(1) : t);
+        const double u = double(1 - t);
+        const P& a = input[segment_idx - 1];
+        const P& b = input[segment_idx];
+        output[i] = Traits::make(Scalar(u * Traits::x(a) + t * Traits::x(b)),
+                                 Scalar(u * Traits::y(a) + t * Traits::y(b)));
+    }
+    output[weights.size] = input[input.size - 1];
+
+    return outputCount;
+}
+
+template <typename P, typename Precision = FloatPrecision>
+size_t resampleWeighted(Span<const typename NonDeduced<P>::type> input, Span<const double> weights, Span<P> output)
+{
+    std::vector<typename Precision::Real> dists(input.size);
+    return resampleWeighted<P, Precision>(input, weights, output, makeSpan(dists));
+}
+
+namespace detail
+{
+// QVector2D::dotProduct() semantics (float components), kept so the results
+// match the original Qt implementation bit for bit.
+inline float dotProduct(double ax, double ay, double bx, double by)
+{
+    return float(ax) * float(bx) + float(ay) * float(by);
+}
+}
+
+/* Walks the polyline with a constant step using the direction of the current
+ * line, and jumps to the next line when the step overruns it. Outputs at most
+ * dataCount + 1 points; in some cases fewer points are produced.
+ *
+ * NB: input mustn't contain identical consecutive points
+ *
+ * Returns the number of points written.
+ */
+template <typename P>
+size_t splitSegments(Span<const typename NonDeduced<P>::type> input, const int dataCount, Span<P> output)
+{
+    typedef PointTraits<P> Traits;
+    typedef typename Traits::Scalar Scalar;
+
+    if (input.size < 2 || dataCount < 1 || output.size < outputPointsCount(dataCount))
+        return 0;
+
+    if (size_t(dataCount) == input.size - 1)
+    {
+        for (size_t i = 0; i < input.size; ++i)
+            output[i] = input[i];
+        return input.size;
+    }
+
+    size_t count = 0;
+    size_t inputPointsIndexA = 0;
+    size_t inputPointsIndexB = 1;
+    double ax = Traits::x(input[0]), ay = Traits::y(input[0]);
+    double bx = Traits::x(input[1]), by = Traits::y(input[1]);
+
+    output[count++] = input[0];
+
+    const size_t lastInputPointsIndex = input.size - 1;
+    const double step = linesLengthBetween2Points<P>(input, 0, lastInputPointsIndex) / dataCount;
+
+    double lengthAB = std::sqrt((bx - ax) * (bx - ax) + (by - ay) * (by - ay));
+    double cosine = (bx - ax) / lengthAB;
+    double sine = (by - ay) / lengthAB;
+
+    double x1 = ax, y1 = ay;
+    double x2, y2;
+
+    for (int i = 0; i < dataCount; ++i)
+    {
+        x2 = x1 + cosine * step;
+        y2 = y1 + sine * step;
+
+        float dotProduct = detail::dotProduct(x2 - bx, y2 - by, bx - ax, by - ay);
+        if (dotProduct > 0)
+        {
+            while (dotProduct > 0 && inputPointsIndexB <= lastInputPointsIndex)
+            {
+                const double overrun = std::sqrt((bx - x2) * (bx - x2) + (by - y2) * (by - y2));
+
+                if (inputPointsIndexB < lastInputPointsIndex)
+                {
+                    ++inputPointsIndexA; // A becomes B
+                    ++inputPointsIndexB; // B becomes its successor
+                    ax = Traits::x(input[inputPointsIndexA]);
+                    ay = Traits::y(input[inputPointsIndexA]);
+                    bx = Traits::x(input[inputPointsIndexB]);
+                    by = Traits::y(input[inputPointsIndexB]);
+                }
+                else
+                {
+                    ax = Traits::x(input[lastInputPointsIndex]);
+                    ay = Traits::y(input[lastInputPointsIndex]);
+                    bx = x2;
+                    by = y2;
+
+                    ++inputPointsIndexB; // increment inputPointsIndexB so we can exit the loop
+                }
+
+                lengthAB = std::sqrt((bx - ax) * (bx - ax) + (by - ay) * (by - ay));
+                cosine = (bx - ax) / lengthAB;
+                sine = (by - ay) / lengthAB;
+                x2 = ax + cosine * overrun;
+                y2 = ay + sine * overrun;
+
+                dotProduct = detail::dotProduct(x2 - bx, y2 - by, bx - ax, by - ay);
+            }
+            if (inputPointsIndexB > lastInputPointsIndex)
+            {
+                output[count++] = input[lastInputPointsIndex];
+                break; // no more input points
+            }
+
+            output[count++] = Traits::make(Scalar(x2), Scalar(y2));
+
+            if (dotProduct == 0. && inputPointsIndexB < lastInputPointsIndex)
+            {
+                ++inputPointsIndexA;
+                ++inputPointsIndexB;
+                ax = Traits::x(input[inputPointsIndexA]);
+                ay = Traits::y(input[inputPointsIndexA]);
+                bx = Traits::x(input[inputPointsIndexB]);
+                by = Traits::y(input[inputPointsIndexB]);
+                lengthAB = std::sqrt((bx - ax) * (bx - ax) + (by - ay) * (by - ay));
+                cosine = (bx - ax) / lengthAB;
+                sine = (by - ay) / lengthAB;
+            }
+        }
+        else
+        {
+            output[count++] = Traits::make(Scalar(x2), Scalar(y2));
+        }
+
+        x1 = x2;
+        y1 = y2;
+    }
+
+    return count;
+}
+
+/* Segments joining consecutive points, viewed over the points themselves:
+ * segment i = (points[i], points[i + 1]). Unlike makeSegments(), nothing is
+ * copied, so it is the cheapest way to consume the splitters' output (the
+ * points buffer is a line strip as is). */
+template <typename P>
+class SegmentView
+{
+public:
+    typedef P Point;
+
+    SegmentView() {}
+    explicit SegmentView(Span<const P> points) : _points(points) {}
+
+    size_t size() const { return _points.size < 2 ? 0 : _points.size - 1; }
+    bool empty() const { return size() == 0; }
+
+    const P& p1(const size_t i) const { return _points[i]; }
+    const P& p2(const size_t i) const { return _points[i + 1]; }
+    Segment<P> operator[](const size_t i) const
+    {
+        Segment<P> segment;
+        segment.p1 = _points[i];
+        segment.p2 = _points[i + 1];
+        return segment;
+    }
+
+    Span<const P> points() const { return _points; }
+
+private:
+    Span<const P> _points;
+};
+
+/* Index buffer of the segments joining 'pointsCount' consecutive points,
+ * as pairs (i, i + 1) (i.e. a line list drawn from the points buffer).
+ * 'indices' must hold 2 * (pointsCount - 1) elements. Returns the number of
+ * segments written. */
+inline size_t makeSegmentIndices(const size_t pointsCount, Span<uint32_t> indices)
+{
+    if (pointsCount < 2 || indices.size < 2 * (pointsCount - 1))
+        return 0;
+
+    for (size_t i = 0; i < pointsCount - 1; ++i)
+    {
+        indices[2 * i] = uint32_t(i);
+        indices[2 * i + 1] = uint32_t(i + 1);
+    }
+    return pointsCount - 1;
+}
+
+/* Builds the segments joining consecutive points.
+ * 'segments' must hold points.size - 1 elements. Returns the number written. */
+template <typename P>
+size_t makeSegments(Span<const typename NonDeduced<P>::type> points, Span<Segment<P> > segments)
+{
+    if (points.size < 2 || segments.size < points.size - 1)
+        return 0;
+
+    for (size_t i = 0; i < points.size - 1; ++i)
+    {
+        segments[i].p1 = points[i];
+        segments[i].p2 = points[i + 1];
+    }
+    return points.size - 1;
+}
+
+}
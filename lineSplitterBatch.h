@@ -0,0 +1,89 @@
+#pragma once
+
+#include "lineSplitter.h"
+
+#include <algorithm>
+
+/* Batch entry points: many polylines stored in flat buffers (CSR layout).
+ *
+ * Polyline k is made of the vertices points[offsets[k]] .. points[offsets[k + 1] - 1],
+ * so 'offsets' holds polylineCount + 1 elements. Its dataCounts[k] output
+ * points are written at outputPoints[outputOffsets[k]], see batchOutputOffsets().
+ */
+namespace LineSplitter
+{
+
+inline size_t batchPolylineCount(Span<const size_t> offsets)
+{
+    return offsets.size > 0 ? offsets.size - 1 : 0;
+}
+
+/* Fills 'outputOffsets' (dataCounts.size + 1 elements) with the offsets of
+ * each polyline's output points and returns the total number of output points,
+ * i.e. the size the output points buffer must have. */
+inline size_t batchOutputOffsets(Span<const int> dataCounts, Span<size_t> outputOffsets)
+{
+    if (outputOffsets.size < dataCounts.size + 1)
+        return 0;
+
+    outputOffsets[0] = 0;
+    for (size_t k = 0; k < dataCounts.size; ++k)
+        outputOffsets[k + 1] = outputOffsets[k] + outputPointsCount(dataCounts[k]);
+
+    return outputOffsets[dataCounts.size];
+}
+
+/* Number of elements the scratch buffer of resampleArcLengthBatch() must hold:
+ * the vertex count of the longest polyline. */
+inline size_t batchScratchSize(Span<const size_t> offsets)
+{
+    size_t maxCount = 0;
+    for (size_t k = 0; k < batchPolylineCount(offsets); ++k)
+        maxCount = std::max(maxCount, offsets[k + 1] - offsets[k]);
+    return maxCount;
+}
+
+/* Resamples every polyline of the batch with resampleArcLength(), reusing
+ * 'dists' as the scratch buffer. Nothing is allocated.
+ *
+ * The output slots of invalid polylines (less than 2 vertices, dataCount < 1)
+ * are left untouched. Returns the number of polylines resampled.
+ */
+template <typename P, typename Precision = FloatPrecision>
+size_t resampleArcLengthBatch(Span<const typename NonDeduced<P>::type> points,
+    Span<const size_t> offsets,
+    Span<const int> dataCounts,
+    Span<P> outputPoints,
+    Span<const size_t> outputOffsets,
+    Span<typename Precision::Real> dists)
+{
+    const size_t polylineCount = batchPolylineCount(offsets);
+    if (polylineCount == 0 || dataCounts.size < polylineCount || outputOffsets.size < polylineCount + 1
+        || offsets[polylineCount] > points.size || outputOffsets[polylineCount] > outputPoints.size)
+        return 0;
+
+    size_t resampled = 0;
+    for (size_t k = 0; k < polylineCount; ++k)
+    {
+        const Span<const P> input(points.data + offsets[k], offsets[k + 1] - offsets[k]);
+        const Span<P> output(outputPoints.data + outputOffsets[k], outputOffsets[k + 1] - outputOffsets[k]);
+
+        if (resampleArcLength<P, Precision>(input, dataCounts[k], output, dists) != 0)
+            ++resampled;
+    }
+
+    return resampled;
+}
+
+template <typename P, typename Precision = FloatPrecision>
+size_t resampleArcLengthBatch(Span<const typename NonDeduced<P>::type> points,
+    Span<const size_t> offsets,
+    Span<const int> dataCounts,
+    Span<P> outputPoints,
+    Span<const size_t> outputOffsets)
+{
+    std::vector<typename Precision::Real> dists(batchScratchSize(offsets));
+    return resampleArcLengthBatch<P, Precision>(points, offsets, dataCounts, outputPoints, outputOffsets, makeSpan(dists));
+}
+
+}
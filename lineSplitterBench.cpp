@@ -0,0 +1,302 @@
+#include "allocationCounter.h"
+#include "arcLengthIndex.h"
+#include "lineSplitter.h"
+#include "lineSplitterParallel.h"
+#include "lineSplitterSimd.h"
+#include "ringResampler.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <random>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+/* Benchmarks of the splitting algorithms (see lineSplitter.h).
+ *
+ * Workloads are parametrized by the number of vertices of the polyline, the
+ * ratio dataCount / vertices (in percent) and the polyline shape. Besides the
+ * time, every benchmark reports the time per output point, the bytes
+ * allocated per iteration and the peak RSS of the process.
+ */
+
+namespace
+{
+
+typedef LineSplitter::Point2<double> Point;
+
+enum Shape
+{
+    Spiral,
+    ZigZag,
+    RandomWalk,
+    Degenerate // random walk where every other segment has a zero length
+};
+
+std::vector<Point> makePolyline(const Shape shape, const size_t count)
+{
+    std::vector<Point> points(count);
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> step(-10., 10.);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        Point& p = points[i];
+        switch (shape)
+        {
+        case Spiral:
+        {
+            const double angle = 0.01 * i;
+            p.x = (1. + angle) * std::cos(angle);
+            p.y = (1. + angle) * std::sin(angle);
+            break;
+        }
+        case ZigZag:
+            p.x = double(i);
+            p.y = (i % 2) ? 10. : 0.;
+            break;
+        case RandomWalk:
+        case Degenerate:
+            if (i == 0)
+                p.x = p.y = 0.;
+            else if (shape == Degenerate && i % 2 == 0)
+                p = points[i - 1];
+            else
+            {
+                p.x = points[i - 1].x + step(rng);
+                p.y = points[i - 1].y + step(rng);
+            }
+            break;
+        }
+    }
+
+    return points;
+}
+
+size_t peakRss()
+{
+#ifndef _WIN32
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        return size_t(usage.ru_maxrss) * 1024; // kilobytes on Linux
+#endif
+    return 0;
+}
+
+int dataCountFor(const benchmark::State& state)
+{
+    const double dataCount = double(state.range(0)) * state.range(1) / 100.;
+    return std::max(1, int(dataCount));
+}
+
+void setCounters(benchmark::State& state, const size_t outputPoints, const size_t allocatedBytes)
+{
+    state.counters["time/point"] = benchmark::Counter(double(outputPoints),
+        benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+    state.counters["allocated"] = benchmark::Counter(double(allocatedBytes),
+        benchmark::Counter::kAvgIterations, benchmark::Counter::kIs1024);
+    state.counters["peakRSS"] = benchmark::Counter(double(peakRss()),
+        benchmark::Counter::kDefaults, benchmark::Counter::kIs1024);
+}
+
+// vertices from 2 to 1e7, dataCount / vertices from 0.01 to 1000 (in percent),
+// at most 1e7 output points
+void workloads(benchmark::internal::Benchmark* b)
+{
+    const long long vertices[] = { 2, 100, 10000, 1000000, 10000000 };
+    const long long ratios[] = { 1, 100, 100000 };
+    for (const long long n : vertices)
+        for (const long long ratio : ratios)
+            if (n * ratio / 100 <= 10000000)
+                b->Args({ n, ratio });
+    b->ArgNames({ "vertices", "ratio%" });
+    b->Unit(benchmark::kMicrosecond);
+}
+
+template <Shape shape, typename Precision>
+void BM_ResampleArcLength(benchmark::State& state)
+{
+    const std::vector<Point> input = makePolyline(shape, size_t(state.range(0)));
+    const int dataCount = dataCountFor(state);
+    std::vector<Point> output(LineSplitter::outputPointsCount(dataCount));
+    std::vector<typename Precision::Real> dists(input.size());
+
+    const size_t allocatedBefore = g_allocatedBytes;
+    for (auto _ : state)
+    {
+        LineSplitter::resampleArcLength<Point, Precision>(LineSplitter::makeSpan(input), dataCount,
+            LineSplitter::makeSpan(output), LineSplitter::makeSpan(dists));
+        benchmark::DoNotOptimize(output.data());
+        benchmark::ClobberMemory();
+    }
+    setCounters(state, output.size(), g_allocatedBytes - allocatedBefore);
+}
+
+template <Shape shape>
+void BM_ResampleArcLengthSimd(benchmark::State& state)
+{
+    const std::vector<Point> input = makePolyline(shape, size_t(state.range(0)));
+    const int dataCount = dataCountFor(state);
+    std::vector<Point> output(LineSplitter::outputPointsCount(dataCount));
+    std::vector<float> dists(input.size());
+
+    const size_t allocatedBefore = g_allocatedBytes;
+    for (auto _ : state)
+    {
+        LineSplitter::resampleArcLengthSimd<Point>(LineSplitter::makeSpan(input), dataCount,
+            LineSplitter::makeSpan(output), LineSplitter::makeSpan(dists));
+        benchmark::DoNotOptimize(output.data());
+        benchmark::ClobberMemory();
+    }
+    setCounters(state, output.size(), g_allocatedBytes - allocatedBefore);
+}
+
+// NB: splitSegments() doesn't support zero-length segments
+template <Shape shape>
+void BM_SplitSegments(benchmark::State& state)
+{
+    const std::vector<Point> input = makePolyline(shape, size_t(state.range(0)));
+    const int dataCount = dataCountFor(state);
+    std::vector<Point> output(LineSplitter::outputPointsCount(dataCount));
+
+    const size_t allocatedBefore = g_allocatedBytes;
+    for (auto _ : state)
+    {
+        LineSplitter::splitSegments<Point>(LineSplitter::makeSpan(input), dataCount, LineSplitter::makeSpan(output));
+        benchmark::DoNotOptimize(output.data());
+        benchmark::ClobberMemory();
+    }
+    setCounters(state, output.size(), g_allocatedBytes - allocatedBefore);
+}
+
+// random weights (durations) from 0.5 to 1.5
+template <Shape shape>
+void BM_ResampleWeighted(benchmark::State& state)
+{
+    const std::vector<Point> input = makePolyline(shape, size_t(state.range(0)));
+    std::vector<double> weights(size_t(dataCountFor(state)));
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> duration(0.5, 1.5);
+    for (double& weight : weights)
+        weight = duration(rng);
+    std::vector<Point> output(weights.size() + 1);
+    std::vector<float> dists(input.size());
+
+    const size_t allocatedBefore = g_allocatedBytes;
+    for (auto _ : state)
+    {
+        LineSplitter::resampleWeighted<Point>(LineSplitter::makeSpan(input), LineSplitter::makeSpan(weights),
+            LineSplitter::makeSpan(output), LineSplitter::makeSpan(dists));
+        benchmark::DoNotOptimize(output.data());
+        benchmark::ClobberMemory();
+    }
+    setCounters(state, output.size(), g_allocatedBytes - allocatedBefore);
+}
+
+// the polyline closed into a ring, starting a third of the way along it
+template <Shape shape>
+void BM_ResampleRing(benchmark::State& state)
+{
+    const std::vector<Point> input = makePolyline(shape, size_t(state.range(0)));
+    const int dataCount = dataCountFor(state);
+    const double startOffset = LineSplitter::RingLengths(LineSplitter::makeSpan(input)).perimeter() / 3.;
+    std::vector<Point> output(LineSplitter::outputPointsCount(dataCount));
+    std::vector<float> dists(input.size() + 1);
+
+    const size_t allocatedBefore = g_allocatedBytes;
+    for (auto _ : state)
+    {
+        LineSplitter::resampleRing<Point>(LineSplitter::makeSpan(input), dataCount, startOffset,
+            LineSplitter::makeSpan(output), LineSplitter::makeSpan(dists));
+        benchmark::DoNotOptimize(output.data());
+        benchmark::ClobberMemory();
+    }
+    setCounters(state, output.size(), g_allocatedBytes - allocatedBefore);
+}
+
+// 1000 polylines of range(0) / 1000 + 2 vertices, on range(1) threads
+void BM_ResampleBatchParallel(benchmark::State& state)
+{
+    const size_t polylineCount = 1000;
+    const size_t verticesPerPolyline = size_t(state.range(0)) / polylineCount + 2;
+    const std::vector<Point> polyline = makePolyline(RandomWalk, verticesPerPolyline);
+
+    std::vector<Point> points;
+    std::vector<size_t> offsets(1, 0);
+    std::vector<int> dataCounts;
+    for (size_t k = 0; k < polylineCount; ++k)
+    {
+        points.insert(points.end(), polyline.begin(), polyline.end());
+        offsets.push_back(points.size());
+        dataCounts.push_back(int(verticesPerPolyline * (1 + k % 10)));
+    }
+    std::vector<size_t> outputOffsets(polylineCount + 1);
+    std::vector<Point> output(LineSplitter::batchOutputOffsets(LineSplitter::makeSpan(dataCounts),
+        LineSplitter::makeSpan(outputOffsets)));
+
+    const size_t allocatedBefore = g_allocatedBytes;
+    for (auto _ : state)
+    {
+        LineSplitter::resampleArcLengthBatchParallel<Point>(LineSplitter::makeSpan(points),
+            LineSplitter::makeSpan(offsets), LineSplitter::makeSpan(dataCounts),
+            LineSplitter::makeSpan(output), LineSplitter::makeSpan(outputOffsets), unsigned(state.range(1)));
+        benchmark::DoNotOptimize(output.data());
+        benchmark::ClobberMemory();
+    }
+    setCounters(state, output.size(), g_allocatedBytes - allocatedBefore);
+}
+
+template <size_t bucketCount>
+void BM_ArcLengthIndexQueries(benchmark::State& state)
+{
+    const std::vector<Point> input = makePolyline(RandomWalk, size_t(state.range(0)));
+    const LineSplitter::ArcLengthIndex<Point> index(LineSplitter::makeSpan(input),
+        bucketCount ? size_t(state.range(0)) : 0);
+
+    std::vector<double> queries(4096);
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> distance(0., index.length());
+    for (double& s : queries)
+        s = distance(rng);
+
+    const size_t allocatedBefore = g_allocatedBytes;
+    for (auto _ : state)
+    {
+        for (const double s : queries)
+            benchmark::DoNotOptimize(index.pointAt(s));
+    }
+    setCounters(state, queries.size(), g_allocatedBytes - allocatedBefore);
+}
+
+}
+
+BENCHMARK_TEMPLATE(BM_ResampleArcLength, Spiral, LineSplitter::FloatPrecision)->Apply(workloads);
+BENCHMARK_TEMPLATE(BM_ResampleArcLength, ZigZag, LineSplitter::FloatPrecision)->Apply(workloads);
+BENCHMARK_TEMPLATE(BM_ResampleArcLength, RandomWalk, LineSplitter::FloatPrecision)->Apply(workloads);
+BENCHMARK_TEMPLATE(BM_ResampleArcLength, Degenerate, LineSplitter::FloatPrecision)->Apply(workloads);
+BENCHMARK_TEMPLATE(BM_ResampleArcLength, RandomWalk, LineSplitter::CompensatedPrecision)->Apply(workloads);
+BENCHMARK_TEMPLATE(BM_ResampleArcLength, RandomWalk, LineSplitter::DoublePrecision)->Apply(workloads);
+
+BENCHMARK_TEMPLATE(BM_ResampleArcLengthSimd, RandomWalk)->Apply(workloads);
+
+BENCHMARK_TEMPLATE(BM_SplitSegments, Spiral)->Apply(workloads);
+BENCHMARK_TEMPLATE(BM_SplitSegments, ZigZag)->Apply(workloads);
+BENCHMARK_TEMPLATE(BM_SplitSegments, RandomWalk)->Apply(workloads);
+
+BENCHMARK_TEMPLATE(BM_ResampleWeighted, RandomWalk)->Apply(workloads);
+BENCHMARK_TEMPLATE(BM_ResampleWeighted, Degenerate)->Apply(workloads);
+
+BENCHMARK_TEMPLATE(BM_ResampleRing, RandomWalk)->Apply(workloads);
+
+BENCHMARK(BM_ResampleBatchParallel)
+    ->ArgsProduct({ { 100000, 10000000 }, { 1, 2, 4, 8, 16, 32 } })
+    ->ArgNames({ "vertices", "threads" })
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+BENCHMARK_TEMPLATE(BM_ArcLengthIndexQueries, 0)->RangeMultiplier(100)->Range(100, 10000000);
+BENCHMARK_TEMPLATE(BM_ArcLengthIndexQueries, 1)->RangeMultiplier(100)->Range(100, 10000000);
+
+BENCHMARK_MAIN();
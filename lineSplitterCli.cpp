@@ -0,0 +1,823 @@
+#include "colorMap.h"
+#include "colorMapPresets.h"
+#include "lineSplitterParallel.h"
+#include "lineSplitterPipeline.h"
+#include "polylineFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+/* Headless batch tool: resamples polylines read from text files and colors
+ * their segments, without any window system (Qt Gui is only linked for the
+ * color maps, no QGuiApplication is created).
+ *
+ *   line_splitter_cli [options] <polylines> <data> <output>
+ *
+ * Line k of <polylines> is polyline k ("x0 y0 x1 y1 ..."), line k of <data>
+ * its data ("v0 v1 ..."). The polyline is resampled (arc length) into as many
+ * segments as values, segment i gets the color of value i. Line k of
+ * <output> is "x0 y0 ... xm ym ; c0 ... cm-1", the colors as #aarrggbb. It
+ * is empty if the polyline has less than 2 vertices or no data.
+ *
+ *   line_splitter_cli [options] <input.lsp> <output.lsp>
+ *
+ * Same thing with binary polyline files (see polylineFile.h): the input and
+ * output files are memory-mapped and resampled/colored in place, without any
+ * parsing or copy.
+ *
+ * Both run as a three-stage pipeline (see lineSplitterPipeline.h): a chunk is
+ * read while the previous one is resampled and colored on all the cores and
+ * the one before is written. Memory only depends on the chunk size, and the
+ * throughput of each stage is printed at the end.
+ *
+ *   line_splitter_cli --pack <polylines> <data> <output.lsp>
+ *
+ * Converts text files into a binary polyline file (two passes over them).
+ */
+
+namespace
+{
+
+typedef LineSplitter::Point2<double> Point;
+typedef LineSplitter::FloatPrecision::Real Real; // distances of resampleArcLength()
+
+const size_t PipelineChunks = 4; // being read, processed and written, plus a spare one
+
+struct Options
+{
+    std::string colorMap = "jet";
+    bool hasRange = false;
+    double min = 0.;
+    double max = 1.;
+    unsigned threadCount = 0;
+    size_t chunkPoints = size_t(1) << 22; // input + output points per chunk of a binary file
+    size_t chunkBytes = size_t(1) << 24; // text per chunk
+    bool pack = false;
+    std::string polylinesPath; // or the binary input
+    std::string dataPath; // empty with a binary input
+    std::string outputPath;
+};
+
+/* Lines [first, first + count) of the text files, then the same polylines
+ * in CSR buffers. The lines and per-polyline buffers are kept from one use of
+ * the chunk to the next for their capacity: a chunk allocates until it has
+ * seen its largest content, then no more. */
+struct Chunk
+{
+    size_t first = 0;
+    size_t count = 0;
+    std::vector<std::string> polylineLines;
+    std::vector<std::string> dataLines;
+
+    std::vector<std::vector<double> > coordinates; // parsed lines
+    std::vector<std::vector<double> > values;
+    std::vector<char> errors;
+
+    std::vector<Point> points;
+    std::vector<size_t> offsets;
+    std::vector<double> data;
+    std::vector<size_t> dataOffsets;
+    std::vector<int> dataCounts;
+
+    std::vector<Point> outputPoints;
+    std::vector<size_t> outputOffsets;
+    std::vector<QRgb> colors; // laid out as 'data'
+    std::vector<std::string> text; // output line of each polyline
+};
+
+/* A chunk of a binary file: the polylines [firstPolyline, lastPolyline), or
+ * the output points [firstPoint, lastPoint) of a single polyline with more
+ * output points than a chunk holds. The cumulative distances of such a
+ * polyline are computed once and shared by its chunks, which compute exactly
+ * the points resampleArcLength() would for the whole polyline. */
+struct BinaryChunk
+{
+    size_t firstPolyline = 0;
+    size_t lastPolyline = 0;
+
+    bool isPart = false;
+    size_t firstPoint = 0;
+    size_t lastPoint = 0;
+    std::shared_ptr<const std::vector<Real> > dists;
+};
+
+void usage()
+{
+    std::fprintf(stderr,
+        "usage: line_splitter_cli [options] <polylines> <data> <output>\n"
+        "       line_splitter_cli [options] <input.lsp> <output.lsp>\n"
+        "       line_splitter_cli --pack <polylines> <data> <output.lsp>\n"
+        "  --colormap <jet|blackbody|cooltowarm|grayscale|xray>  (default: jet)\n"
+        "  --range <min> <max>  data mapped to the ends of the color map\n"
+        "                       (default: range of the data, an extra pass over <data>)\n"
+        "  --threads <n>        0 = all the hardware threads (default)\n"
+        "  --chunk <points>     input + output points per chunk of a binary file (default: 4194304)\n"
+        "  --chunk-bytes <n>    text per chunk (default: 16777216)\n"
+        "<output> may be '-' (standard output).\n");
+}
+
+bool parseOptions(const int argc, char* argv[], Options& options)
+{
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const int remaining = argc - 1 - i;
+        if (arg == "--colormap" && remaining >= 1)
+            options.colorMap = argv[++i];
+        else if (arg == "--range" && remaining >= 2)
+        {
+            options.hasRange = true;
+            options.min = std::strtod(argv[++i], nullptr);
+            options.max = std::strtod(argv[++i], nullptr);
+        }
+        else if (arg == "--threads" && remaining >= 1)
+            options.threadCount = unsigned(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--chunk" && remaining >= 1)
+            options.chunkPoints = std::max<size_t>(1, size_t(std::strtoull(argv[++i], nullptr, 10)));
+        else if (arg == "--chunk-bytes" && remaining >= 1)
+            options.chunkBytes = std::max<size_t>(1, size_t(std::strtoull(argv[++i], nullptr, 10)));
+        else if (arg == "--pack")
+            options.pack = true;
+        else if (arg.size() > 1 && arg[0] == '-' && arg != "-")
+            return false;
+        else
+            paths.push_back(arg);
+    }
+
+    if (paths.size() == 2 && !options.pack)
+    {
+        options.polylinesPath = paths[0];
+        options.outputPath = paths[1];
+        return true;
+    }
+    if (paths.size() != 3)
+        return false;
+
+    options.polylinesPath = paths[0];
+    options.dataPath = paths[1];
+    options.outputPath = paths[2];
+    return true;
+}
+
+bool makeColorMap(const std::string& name, LinearColorMap& colorMap)
+{
+    ColorMapPresets::ControlPoints controlPoints;
+    if (name == "jet")
+        controlPoints = ColorMapPresets::Jet();
+    else if (name == "blackbody")
+        controlPoints = ColorMapPresets::BlackBodyRadiation();
+    else if (name == "cooltowarm")
+        controlPoints = ColorMapPresets::CoolToWarm();
+    else if (name == "grayscale")
+        controlPoints = ColorMapPresets::Grayscale();
+    else if (name == "xray")
+        controlPoints = ColorMapPresets::XRay();
+    else
+        return false;
+
+    colorMap = ColorMapPresets::controlPointsToLinearColorMap(controlPoints);
+    return true;
+}
+
+// appends the numbers of 'line' to 'values', false on a malformed number
+bool parseNumbers(const std::string& line, std::vector<double>& values)
+{
+    const char* p = line.c_str();
+    for (;;)
+    {
+        while (*p == ' ' || *p == '\t' || *p == ',' || *p == '\r')
+            ++p;
+        if (*p == '\0')
+            return true;
+
+        char* end;
+        const double value = std::strtod(p, &end);
+        if (end == p)
+            return false;
+        values.push_back(value);
+        p = end;
+    }
+}
+
+// widens [min, max] to the non-NaN values
+void valuesRange(LineSplitter::Span<const double> values, double& min, double& max)
+{
+    for (const double value : values)
+    {
+        if (value < min)
+            min = value;
+        if (value > max)
+            max = value;
+    }
+}
+
+// range of the non-NaN values of the data file (min > max if there is none)
+bool dataRange(const std::string& path, double& min, double& max)
+{
+    std::ifstream file(path);
+    if (!file)
+        return false;
+
+    min = HUGE_VAL;
+    max = -HUGE_VAL;
+    std::string line;
+    std::vector<double> values;
+    while (std::getline(file, line))
+    {
+        values.clear();
+        if (!parseNumbers(line, values))
+            return false;
+        valuesRange(LineSplitter::makeSpan(values), min, max);
+    }
+    return true;
+}
+
+// range of the data when there is no data or a single value
+void fixRange(Options& options)
+{
+    if (options.min > options.max)
+    {
+        options.min = 0.;
+        options.max = 1.;
+    }
+    else if (options.min == options.max)
+        options.max = options.min + 1.;
+}
+
+/* Reads line pairs into the chunk until it holds 'chunkBytes' of text (one
+ * pair at least: a polyline is never split between two chunks). Returns the
+ * bytes read, 0 at the end of the files or on error ('error' set). */
+size_t readLines(std::istream& polylines, std::istream& data, const size_t chunkBytes, Chunk& chunk, bool& error)
+{
+    chunk.count = 0;
+    size_t bytes = 0;
+    while (bytes < chunkBytes)
+    {
+        if (chunk.count == chunk.polylineLines.size())
+        {
+            chunk.polylineLines.resize(chunk.count + 1);
+            chunk.dataLines.resize(chunk.count + 1);
+        }
+
+        std::string& polylineLine = chunk.polylineLines[chunk.count];
+        std::string& dataLine = chunk.dataLines[chunk.count];
+        const bool hasPolyline = bool(std::getline(polylines, polylineLine));
+        const bool hasData = bool(std::getline(data, dataLine));
+        if (!hasPolyline || !hasData)
+        {
+            if (hasPolyline != hasData)
+            {
+                std::fprintf(stderr, "error: the polylines and data files don't have the same number of lines\n");
+                error = true;
+                return 0;
+            }
+            break;
+        }
+
+        bytes += polylineLine.size() + dataLine.size() + 2;
+        ++chunk.count;
+    }
+    return bytes;
+}
+
+/* Parses the lines of the chunk (in parallel) into its CSR buffers. Reports
+ * the first malformed line and returns false if there is one. */
+bool parseLines(Chunk& chunk, const unsigned threadCount)
+{
+    enum
+    {
+        NoError,
+        PolylineError,
+        DataError,
+        TooManyValues
+    };
+
+    const size_t count = chunk.count;
+    if (chunk.coordinates.size() < count)
+    {
+        chunk.coordinates.resize(count);
+        chunk.values.resize(count);
+    }
+    chunk.errors.assign(count, NoError);
+    LineSplitter::detail::parallelFor(count, threadCount, [&](const size_t k, const unsigned) {
+        std::vector<double>& coordinates = chunk.coordinates[k];
+        std::vector<double>& values = chunk.values[k];
+        coordinates.clear();
+        values.clear();
+        if (!parseNumbers(chunk.polylineLines[k], coordinates) || coordinates.size() % 2 != 0)
+            chunk.errors[k] = PolylineError;
+        else if (!parseNumbers(chunk.dataLines[k], values))
+            chunk.errors[k] = DataError;
+        else if (values.size() > size_t(std::numeric_limits<int>::max()) - 1)
+            chunk.errors[k] = TooManyValues;
+    });
+
+    chunk.points.clear();
+    chunk.offsets.assign(1, 0);
+    chunk.data.clear();
+    chunk.dataOffsets.assign(1, 0);
+    chunk.dataCounts.clear();
+    for (size_t k = 0; k < count; ++k)
+    {
+        const size_t lineNumber = chunk.first + k + 1;
+        switch (chunk.errors[k])
+        {
+        case PolylineError:
+            std::fprintf(stderr, "error: polylines, line %zu: expected x y pairs\n", lineNumber);
+            return false;
+        case DataError:
+            std::fprintf(stderr, "error: data, line %zu: malformed number\n", lineNumber);
+            return false;
+        case TooManyValues:
+            std::fprintf(stderr, "error: data, line %zu: too many values\n", lineNumber);
+            return false;
+        }
+
+        const std::vector<double>& coordinates = chunk.coordinates[k];
+        for (size_t i = 0; i < coordinates.size(); i += 2)
+        {
+            const Point point = { coordinates[i], coordinates[i + 1] };
+            chunk.points.push_back(point);
+        }
+        const std::vector<double>& values = chunk.values[k];
+        chunk.data.insert(chunk.data.end(), values.begin(), values.end());
+        chunk.offsets.push_back(chunk.points.size());
+        chunk.dataOffsets.push_back(chunk.data.size());
+        chunk.dataCounts.push_back(int(values.size()));
+    }
+    return true;
+}
+
+void formatPolyline(const Chunk& chunk, const size_t k, std::string& text)
+{
+    text.clear();
+    const size_t outputCount = chunk.outputOffsets[k + 1] - chunk.outputOffsets[k];
+    if (chunk.offsets[k + 1] - chunk.offsets[k] < 2 || outputCount == 0)
+        return;
+
+    char buffer[64];
+    for (size_t i = chunk.outputOffsets[k]; i < chunk.outputOffsets[k + 1]; ++i)
+    {
+        const int n = std::snprintf(buffer, sizeof(buffer), i == chunk.outputOffsets[k] ? "%.9g %.9g" : " %.9g %.9g",
+            chunk.outputPoints[i].x, chunk.outputPoints[i].y);
+        text.append(buffer, size_t(n));
+    }
+    text += " ;";
+    for (size_t i = chunk.dataOffsets[k]; i < chunk.dataOffsets[k + 1]; ++i)
+    {
+        const int n = std::snprintf(buffer, sizeof(buffer), " #%08x", unsigned(chunk.colors[i]));
+        text.append(buffer, size_t(n));
+    }
+}
+
+/* Resamples, colors and formats the polylines of the chunk: the resampling
+ * splits long polylines between the threads, the colors and the text are
+ * computed polyline by polyline. */
+void processChunk(Chunk& chunk, const CompiledColorMap& colorMap, const unsigned threadCount)
+{
+    const size_t count = chunk.count;
+    chunk.outputOffsets.resize(count + 1);
+    chunk.outputPoints.resize(LineSplitter::batchOutputOffsets(LineSplitter::makeSpan(chunk.dataCounts),
+        LineSplitter::makeSpan(chunk.outputOffsets)));
+    LineSplitter::resampleArcLengthBatchParallel<Point>(LineSplitter::makeSpan(chunk.points),
+        LineSplitter::makeSpan(chunk.offsets), LineSplitter::makeSpan(chunk.dataCounts),
+        LineSplitter::makeSpan(chunk.outputPoints), LineSplitter::makeSpan(chunk.outputOffsets), threadCount);
+
+    chunk.colors.resize(chunk.data.size());
+    if (chunk.text.size() < count)
+        chunk.text.resize(count);
+    LineSplitter::detail::parallelFor(count, threadCount, [&](const size_t k, const unsigned) {
+        const size_t begin = chunk.dataOffsets[k];
+        colorMap.mapBatch(colorMap.min(), colorMap.max(), chunk.data.data() + begin, chunk.colors.data() + begin,
+            chunk.dataOffsets[k + 1] - begin);
+        formatPolyline(chunk, k, chunk.text[k]);
+    });
+}
+
+// colors by blocks of values
+void colorValues(const CompiledColorMap& colorMap, LineSplitter::Span<const double> values,
+    LineSplitter::Span<uint32_t> colors, const unsigned threadCount)
+{
+    const size_t blockSize = 65536;
+    LineSplitter::detail::parallelFor((values.size + blockSize - 1) / blockSize, threadCount,
+        [&](const size_t block, const unsigned) {
+            const size_t begin = block * blockSize;
+            colorMap.mapBatch(colorMap.min(), colorMap.max(), values.data + begin, colors.data + begin,
+                std::min(blockSize, values.size - begin));
+        });
+}
+
+/* Throughput of each stage, over the time it was busy. The stage busy the
+ * longest is the bottleneck: speeding up the others won't help. */
+void printCounters(const LineSplitter::PipelineCounters& counters, const char* readUnits, const char* processUnits,
+    const char* writeUnits)
+{
+    struct Stage
+    {
+        const char* name;
+        const char* units;
+        const LineSplitter::StageCounters* counters;
+    };
+    const Stage stages[] = {
+        { "read", readUnits, &counters.read },
+        { "process", processUnits, &counters.process },
+        { "write", writeUnits, &counters.write } };
+
+    const Stage* bottleneck = &stages[0];
+    for (const Stage& stage : stages)
+    {
+        const LineSplitter::StageCounters& c = *stage.counters;
+        std::fprintf(stderr, "%-7s %6zu chunks %12.0f %s/s %9.1f MB/s  busy %7.3f s  waiting %7.3f s\n", stage.name,
+            c.chunks, c.unitsPerSecond(), stage.units, c.bytesPerSecond() / 1e6, c.busySeconds, c.waitSeconds);
+        if (c.busySeconds > bottleneck->counters->busySeconds)
+            bottleneck = &stage;
+    }
+    std::fprintf(stderr, "%.3f s, bottleneck: %s\n", counters.seconds, bottleneck->name);
+}
+
+}
+
+/* Text files to a binary polyline file: the first pass counts the polylines,
+ * vertices and values, the second one fills the mapped file. */
+int pack(const Options& options)
+{
+    LineSplitter::PolylineFileWriter output;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        std::ifstream polylines(options.polylinesPath);
+        std::ifstream data(options.dataPath);
+        if (!polylines || !data)
+        {
+            std::fprintf(stderr, "error: cannot read '%s'\n",
+                (!polylines ? options.polylinesPath : options.dataPath).c_str());
+            return 1;
+        }
+
+        size_t polylineCount = 0, vertexCount = 0, valueCount = 0;
+        Chunk chunk;
+        bool error = false;
+        for (;;)
+        {
+            chunk.first = polylineCount;
+            if (readLines(polylines, data, options.chunkBytes, chunk, error) == 0)
+                break;
+            if (!parseLines(chunk, options.threadCount))
+                return 1;
+
+            if (pass == 1)
+            {
+                std::copy(chunk.points.begin(), chunk.points.end(), output.vertices().begin() + vertexCount);
+                std::copy(chunk.data.begin(), chunk.data.end(), output.values().begin() + valueCount);
+                for (size_t k = 0; k < chunk.count; ++k)
+                {
+                    output.offsets()[polylineCount + k + 1] = vertexCount + chunk.offsets[k + 1];
+                    output.valueOffsets()[polylineCount + k + 1] = valueCount + chunk.dataOffsets[k + 1];
+                }
+            }
+            polylineCount += chunk.count;
+            vertexCount += chunk.points.size();
+            valueCount += chunk.data.size();
+        }
+        if (error)
+            return 1;
+
+        if (pass == 0 && !output.create(options.outputPath.c_str(), polylineCount, vertexCount, valueCount, false))
+        {
+            std::fprintf(stderr, "error: %s\n", output.errorString().c_str());
+            return 1;
+        }
+        if (pass == 1)
+            std::fprintf(stderr, "%zu polylines, %zu vertices, %zu values\n", polylineCount, vertexCount, valueCount);
+    }
+
+    if (!output.close())
+    {
+        std::fprintf(stderr, "error: %s\n", output.errorString().c_str());
+        return 1;
+    }
+    return 0;
+}
+
+/* Text files in, text file out. Reading, parsing + resampling + coloring +
+ * formatting and writing run in the three stages of the pipeline. */
+int processText(Options& options, const LinearColorMap& linearColorMap)
+{
+    if (!options.hasRange)
+    {
+        if (!dataRange(options.dataPath, options.min, options.max))
+        {
+            std::fprintf(stderr, "error: cannot read '%s'\n", options.dataPath.c_str());
+            return 1;
+        }
+        fixRange(options);
+    }
+
+    CompiledColorMap colorMap;
+    colorMap.compile(linearColorMap, options.min, options.max);
+
+    std::ifstream polylines(options.polylinesPath);
+    std::ifstream data(options.dataPath);
+    if (!polylines || !data)
+    {
+        std::fprintf(stderr, "error: cannot read '%s'\n", (!polylines ? options.polylinesPath : options.dataPath).c_str());
+        return 1;
+    }
+
+    const bool toStdout = options.outputPath == "-";
+    FILE* output = toStdout ? stdout : std::fopen(options.outputPath.c_str(), "wb");
+    if (!output)
+    {
+        std::fprintf(stderr, "error: cannot write '%s'\n", options.outputPath.c_str());
+        return 1;
+    }
+
+    size_t polylineCount = 0;
+    size_t skipped = 0;
+    bool readError = false;
+    LineSplitter::PipelineCounters counters;
+    bool ok = LineSplitter::runPipeline<Chunk>(
+        [&](Chunk& chunk, LineSplitter::StageCounters& c) {
+            chunk.first = polylineCount;
+            const size_t bytes = readLines(polylines, data, options.chunkBytes, chunk, readError);
+            polylineCount += chunk.count;
+            c.units += chunk.count;
+            c.bytes += bytes;
+            return bytes != 0;
+        },
+        [&](Chunk& chunk, LineSplitter::StageCounters& c) {
+            if (!parseLines(chunk, options.threadCount))
+                return false;
+            processChunk(chunk, colorMap, options.threadCount);
+            c.units += chunk.outputPoints.size();
+            c.bytes += chunk.points.size() * sizeof(Point) + chunk.data.size() * sizeof(double);
+            return true;
+        },
+        [&](Chunk& chunk, LineSplitter::StageCounters& c) {
+            for (size_t k = 0; k < chunk.count; ++k)
+            {
+                const std::string& text = chunk.text[k];
+                skipped += text.empty();
+                std::fwrite(text.data(), 1, text.size(), output);
+                std::fputc('\n', output);
+                c.bytes += text.size() + 1;
+            }
+            c.units += chunk.count;
+            return std::ferror(output) == 0;
+        },
+        PipelineChunks, counters);
+
+    if (std::ferror(output) || (!toStdout && std::fclose(output) != 0))
+    {
+        std::fprintf(stderr, "error: cannot write '%s'\n", options.outputPath.c_str());
+        return 1;
+    }
+    if (!ok || readError)
+        return 1;
+
+    printCounters(counters, "polylines", "points", "polylines");
+    std::fprintf(stderr, "%zu polylines (%zu skipped: less than 2 vertices or no data)\n", polylineCount, skipped);
+    return 0;
+}
+
+/* Binary polyline file in, binary polyline file out: the resampler reads the
+ * vertices from the input mapping and writes the points in the output one.
+ * The read stage prefetches the input of a chunk, the write stage writes its
+ * output back and drops both from memory: only the chunks in flight are
+ * resident, whatever the size of the files. */
+int processBinary(Options& options, const LinearColorMap& linearColorMap)
+{
+    LineSplitter::PolylineFileReader input;
+    if (!input.open(options.polylinesPath.c_str()))
+    {
+        std::fprintf(stderr, "error: %s\n", input.errorString().c_str());
+        return 1;
+    }
+
+    if (!options.hasRange)
+    {
+        options.min = HUGE_VAL;
+        options.max = -HUGE_VAL;
+        valuesRange(input.values(), options.min, options.max);
+        fixRange(options);
+    }
+    CompiledColorMap colorMap;
+    colorMap.compile(linearColorMap, options.min, options.max);
+
+    // polylines that can't be resampled get no output point
+    const size_t polylineCount = input.polylineCount();
+    std::vector<int> dataCounts(polylineCount);
+    size_t skipped = 0;
+    for (size_t k = 0; k < polylineCount; ++k)
+    {
+        const size_t valueCount = input.valueOffsets()[k + 1] - input.valueOffsets()[k];
+        dataCounts[k] = input.polyline(k).size >= 2 ? int(valueCount) : 0;
+        skipped += dataCounts[k] == 0;
+    }
+    std::vector<size_t> outputOffsets(polylineCount + 1);
+    const size_t outputCount = LineSplitter::batchOutputOffsets(LineSplitter::makeSpan(dataCounts),
+        LineSplitter::makeSpan(outputOffsets));
+
+    LineSplitter::PolylineFileWriter output;
+    if (!output.create(options.outputPath.c_str(), polylineCount, outputCount, input.values().size, true))
+    {
+        std::fprintf(stderr, "error: %s\n", output.errorString().c_str());
+        return 1;
+    }
+    std::copy(outputOffsets.begin(), outputOffsets.end(), output.offsets().begin());
+    std::copy(input.valueOffsets().begin(), input.valueOffsets().end(), output.valueOffsets().begin());
+
+    const LineSplitter::Span<const size_t> offsets = input.offsets();
+    const LineSplitter::Span<const size_t> valueOffsets = input.valueOffsets();
+    auto outputPointsOf = [&](const size_t k) { return outputOffsets[k + 1] - outputOffsets[k]; };
+    auto pointsOf = [&](const size_t k) { return offsets[k + 1] - offsets[k] + outputPointsOf(k); };
+
+    // values [first, last) of a chunk, i.e. its segments
+    auto chunkValues = [&](const BinaryChunk& chunk, size_t& first, size_t& last) {
+        first = valueOffsets[chunk.firstPolyline];
+        last = valueOffsets[chunk.lastPolyline];
+        if (chunk.isPart)
+        {
+            const size_t segmentCount = size_t(dataCounts[chunk.firstPolyline]);
+            last = first + std::min(chunk.lastPoint, segmentCount);
+            first += std::min(chunk.firstPoint, segmentCount);
+        }
+    };
+
+    size_t nextPolyline = 0;
+    size_t nextPoint = 0; // in the polyline being split between chunks
+    std::shared_ptr<const std::vector<Real> > dists;
+    LineSplitter::PipelineCounters counters;
+    bool ok = LineSplitter::runPipeline<BinaryChunk>(
+        [&](BinaryChunk& chunk, LineSplitter::StageCounters& c) {
+            if (nextPolyline == polylineCount)
+                return false;
+
+            const size_t k = nextPolyline;
+            chunk.firstPolyline = k;
+            chunk.isPart = outputPointsOf(k) > options.chunkPoints;
+            if (chunk.isPart)
+            {
+                if (nextPoint == 0)
+                {
+                    std::shared_ptr<std::vector<Real> > polylineDists(new std::vector<Real>(input.polyline(k).size));
+                    LineSplitter::cumulativeDistances<Point>(input.polyline(k), polylineDists->data());
+                    dists = polylineDists;
+                    c.bytes += input.polyline(k).size * sizeof(Point);
+                }
+                chunk.lastPolyline = k + 1;
+                chunk.firstPoint = nextPoint;
+                chunk.lastPoint = std::min(outputPointsOf(k), nextPoint + options.chunkPoints);
+                chunk.dists = dists;
+                nextPoint = chunk.lastPoint;
+                if (nextPoint == outputPointsOf(k))
+                {
+                    nextPolyline = k + 1;
+                    nextPoint = 0;
+                    dists.reset();
+                    ++c.units;
+                }
+                return true;
+            }
+
+            // whole polylines, up to 'chunkPoints' input + output points (one polyline at least)
+            size_t last = k + 1;
+            size_t points = pointsOf(k);
+            while (last < polylineCount && outputPointsOf(last) <= options.chunkPoints
+                && points + pointsOf(last) <= options.chunkPoints)
+                points += pointsOf(last++);
+            chunk.lastPolyline = last;
+            nextPolyline = last;
+
+            const LineSplitter::Span<const Point> vertices(input.vertices().data + offsets[k], offsets[last] - offsets[k]);
+            const LineSplitter::Span<const double> values(input.values().data + valueOffsets[k],
+                valueOffsets[last] - valueOffsets[k]);
+            input.prefetch(vertices);
+            input.prefetch(values);
+            c.units += last - k;
+            c.bytes += vertices.size * sizeof(Point) + values.size * sizeof(double);
+            return true;
+        },
+        [&](BinaryChunk& chunk, LineSplitter::StageCounters& c) {
+            const size_t k = chunk.firstPolyline;
+            if (chunk.isPart)
+            {
+                const LineSplitter::Span<const Real> polylineDists = LineSplitter::makeSpan(*chunk.dists);
+                const Real step = LineSplitter::arcLengthStep(polylineDists, dataCounts[k]);
+                const size_t grainSize = 16384;
+                LineSplitter::detail::parallelFor((chunk.lastPoint - chunk.firstPoint + grainSize - 1) / grainSize,
+                    options.threadCount, [&](const size_t task, const unsigned) {
+                        const size_t first = chunk.firstPoint + task * grainSize;
+                        LineSplitter::resampleArcLengthRange<Point, Real>(input.polyline(k), polylineDists, step, first,
+                            std::min(chunk.lastPoint, first + grainSize), output.vertices().data + outputOffsets[k]);
+                    });
+                c.units += chunk.lastPoint - chunk.firstPoint;
+            }
+            else
+            {
+                const size_t count = chunk.lastPolyline - k;
+                LineSplitter::resampleArcLengthBatchParallel<Point>(input.vertices(),
+                    LineSplitter::Span<const size_t>(offsets.data + k, count + 1),
+                    LineSplitter::Span<const int>(dataCounts.data() + k, count), output.vertices(),
+                    LineSplitter::Span<const size_t>(outputOffsets.data() + k, count + 1), options.threadCount);
+                c.units += outputOffsets[chunk.lastPolyline] - outputOffsets[k];
+            }
+
+            size_t firstValue, lastValue;
+            chunkValues(chunk, firstValue, lastValue);
+            const LineSplitter::Span<const double> values(input.values().data + firstValue, lastValue - firstValue);
+            std::copy(values.begin(), values.end(), output.values().begin() + firstValue);
+            colorValues(colorMap, values, LineSplitter::Span<uint32_t>(output.colors().data + firstValue, values.size),
+                options.threadCount);
+            c.bytes += values.size * sizeof(double);
+            return true;
+        },
+        [&](BinaryChunk& chunk, LineSplitter::StageCounters& c) {
+            const size_t k = chunk.firstPolyline;
+            size_t firstPoint = outputOffsets[k], lastPoint = outputOffsets[chunk.lastPolyline];
+            if (chunk.isPart)
+            {
+                lastPoint = firstPoint + chunk.lastPoint;
+                firstPoint += chunk.firstPoint;
+            }
+            size_t firstValue, lastValue;
+            chunkValues(chunk, firstValue, lastValue);
+
+            bool flushed = output.flush(LineSplitter::Span<Point>(output.vertices().data + firstPoint,
+                lastPoint - firstPoint));
+            flushed = output.flush(LineSplitter::Span<double>(output.values().data + firstValue,
+                lastValue - firstValue)) && flushed;
+            flushed = output.flush(LineSplitter::Span<uint32_t>(output.colors().data + firstValue,
+                lastValue - firstValue)) && flushed;
+            c.bytes += (lastPoint - firstPoint) * sizeof(Point)
+                + (lastValue - firstValue) * (sizeof(double) + sizeof(uint32_t));
+
+            // the input of a split polyline is used until its last chunk
+            if (!chunk.isPart || chunk.lastPoint == outputPointsOf(k))
+            {
+                input.release(LineSplitter::Span<const Point>(input.vertices().data + offsets[k],
+                    offsets[chunk.lastPolyline] - offsets[k]));
+                input.release(LineSplitter::Span<const double>(input.values().data + valueOffsets[k],
+                    valueOffsets[chunk.lastPolyline] - valueOffsets[k]));
+                c.units += chunk.lastPolyline - k;
+            }
+            chunk.dists.reset();
+            return flushed;
+        },
+        PipelineChunks, counters);
+
+    if (!output.close())
+    {
+        std::fprintf(stderr, "error: %s\n", output.errorString().c_str());
+        return 1;
+    }
+    if (!ok)
+    {
+        std::fprintf(stderr, "error: cannot write '%s'\n", options.outputPath.c_str());
+        return 1;
+    }
+
+    printCounters(counters, "polylines", "points", "polylines");
+    std::fprintf(stderr, "%zu polylines (%zu skipped: less than 2 vertices or no data)\n", polylineCount, skipped);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        usage();
+        return 2;
+    }
+
+    LinearColorMap linearColorMap;
+    if (!makeColorMap(options.colorMap, linearColorMap))
+    {
+        std::fprintf(stderr, "error: unknown color map '%s'\n", options.colorMap.c_str());
+        return 2;
+    }
+
+    if (options.hasRange && !(options.max > options.min))
+    {
+        std::fprintf(stderr, "error: empty range\n");
+        return 2;
+    }
+
+    if (options.threadCount == 0)
+        options.threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    if (options.pack)
+        return pack(options);
+    if (options.dataPath.empty())
+        return processBinary(options, linearColorMap);
+    return processText(options, linearColorMap);
+}
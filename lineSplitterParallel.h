@@ -0,0 +1,261 @@
+#pragma once
+
+#include "lineSplitterBatch.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+/* Multithreaded version of resampleArcLengthBatch().
+ *
+ * Polylines are grouped into tasks of roughly 'grainSize' vertices + output
+ * points which are distributed over the threads with work stealing. Polylines
+ * longer than that get their own task for the cumulative distances, then their
+ * output points are computed in several tasks of 'grainSize' points.
+ *
+ * Every output point is computed by resampleArcLengthRange() from the same
+ * cumulative distances as in the single-threaded version, so the result is
+ * identical whatever the number of threads.
+ */
+namespace LineSplitter
+{
+
+namespace detail
+{
+
+/* Each worker owns a contiguous range of task indices that it consumes from
+ * the front. An idle worker steals the back half of another worker's range. */
+class WorkStealingQueue
+{
+public:
+    WorkStealingQueue() : _begin(0), _end(0) {}
+
+    void assign(size_t begin, size_t end)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _begin = begin;
+        _end = end;
+    }
+
+    bool pop(size_t& task)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_begin == _end)
+            return false;
+        task = _begin++;
+        return true;
+    }
+
+    bool steal(size_t& begin, size_t& end)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        const size_t count = _end - _begin;
+        if (count == 0)
+            return false;
+        end = _end;
+        begin = _end - (count + 1) / 2;
+        _end = begin;
+        return true;
+    }
+
+private:
+    std::mutex _mutex;
+    size_t _begin;
+    size_t _end;
+};
+
+/* Calls fn(task, worker) for every task in [0, taskCount) on 'threadCount'
+ * threads (the calling thread included). */
+template <typename Function>
+void parallelFor(const size_t taskCount, unsigned threadCount, Function fn)
+{
+    if (threadCount > taskCount)
+        threadCount = unsigned(taskCount);
+
+    if (threadCount <= 1)
+    {
+        for (size_t task = 0; task < taskCount; ++task)
+            fn(task, 0u);
+        return;
+    }
+
+    std::vector<WorkStealingQueue> queues(threadCount);
+    for (unsigned w = 0; w < threadCount; ++w)
+        queues[w].assign(taskCount * w / threadCount, taskCount * (w + 1) / threadCount);
+
+    auto worker = [&](const unsigned w) {
+        for (;;)
+        {
+            size_t task;
+            if (queues[w].pop(task))
+            {
+                fn(task, w);
+                continue;
+            }
+
+            bool stolen = false;
+            for (unsigned v = 1; v < threadCount && !stolen; ++v)
+            {
+                size_t begin, end;
+                if (queues[(w + v) % threadCount].steal(begin, end))
+                {
+                    queues[w].assign(begin, end);
+                    stolen = true;
+                }
+            }
+            if (!stolen)
+                return;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount - 1);
+    for (unsigned w = 1; w < threadCount; ++w)
+        threads.push_back(std::thread(worker, w));
+    worker(0);
+    for (auto& thread : threads)
+        thread.join();
+}
+
+}
+
+/* 'threadCount' = 0 uses all the hardware threads. */
+template <typename P, typename Precision = FloatPrecision>
+size_t resampleArcLengthBatchParallel(Span<const typename NonDeduced<P>::type> points,
+    Span<const size_t> offsets,
+    Span<const int> dataCounts,
+    Span<P> outputPoints,
+    Span<const size_t> outputOffsets,
+    unsigned threadCount = 0,
+    const size_t grainSize = 16384)
+{
+    const size_t polylineCount = batchPolylineCount(offsets);
+    if (polylineCount == 0 || dataCounts.size < polylineCount || outputOffsets.size < polylineCount + 1
+        || offsets[polylineCount] > points.size || outputOffsets[polylineCount] > outputPoints.size)
+        return 0;
+
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    auto cost = [&](const size_t k) {
+        return (offsets[k + 1] - offsets[k]) + (outputOffsets[k + 1] - outputOffsets[k]);
+    };
+    auto input = [&](const size_t k) {
+        return Span<const P>(points.data + offsets[k], offsets[k + 1] - offsets[k]);
+    };
+    auto isValid = [&](const size_t k) {
+        const size_t outputCount = outputPointsCount(dataCounts[k]);
+        return offsets[k + 1] - offsets[k] >= 2 && outputCount != 0
+            && outputOffsets[k + 1] - outputOffsets[k] >= outputCount;
+    };
+
+    /* Tasks of the first pass: [polylineBegin, polylineEnd) ranges of short
+     * polylines, or a single long polyline whose distances are stored in
+     * 'longDists' at longDistsOffsets[l]. */
+    struct Task
+    {
+        size_t polylineBegin;
+        size_t polylineEnd;
+        size_t longIndex;
+    };
+    const size_t noLongIndex = size_t(-1);
+
+    std::vector<Task> tasks;
+    std::vector<size_t> longPolylines;
+    std::vector<size_t> longDistsOffsets(1, 0);
+    size_t shortScratchSize = 0;
+    {
+        Task current = { 0, 0, noLongIndex };
+        size_t currentCost = 0;
+        for (size_t k = 0; k < polylineCount; ++k)
+        {
+            if (cost(k) > grainSize)
+            {
+                if (current.polylineEnd > current.polylineBegin)
+                    tasks.push_back(current);
+                const Task longTask = { k, k + 1, longPolylines.size() };
+                tasks.push_back(longTask);
+                longPolylines.push_back(k);
+                longDistsOffsets.push_back(longDistsOffsets.back() + (offsets[k + 1] - offsets[k]));
+
+                current.polylineBegin = current.polylineEnd = k + 1;
+                currentCost = 0;
+                continue;
+            }
+
+            shortScratchSize = std::max(shortScratchSize, offsets[k + 1] - offsets[k]);
+            current.polylineEnd = k + 1;
+            currentCost += cost(k);
+            if (currentCost >= grainSize)
+            {
+                tasks.push_back(current);
+                current.polylineBegin = k + 1;
+                currentCost = 0;
+            }
+        }
+        if (current.polylineEnd > current.polylineBegin)
+            tasks.push_back(current);
+    }
+
+    typedef typename Precision::Real Real;
+    std::vector<Real> longDists(longDistsOffsets.back());
+    std::vector<std::vector<Real> > workerDists(threadCount, std::vector<Real>(shortScratchSize));
+    std::atomic<size_t> resampled(0);
+
+    detail::parallelFor(tasks.size(), threadCount, [&](const size_t t, const unsigned worker) {
+        const Task& task = tasks[t];
+        if (task.longIndex != noLongIndex)
+        {
+            const size_t k = task.polylineBegin;
+            if (isValid(k))
+                cumulativeDistances<P, Precision>(input(k), longDists.data() + longDistsOffsets[task.longIndex]);
+            return;
+        }
+
+        size_t count = 0;
+        for (size_t k = task.polylineBegin; k < task.polylineEnd; ++k)
+        {
+            const Span<P> output(outputPoints.data + outputOffsets[k], outputOffsets[k + 1] - outputOffsets[k]);
+            if (resampleArcLength<P, Precision>(input(k), dataCounts[k], output, makeSpan(workerDists[worker])) != 0)
+                ++count;
+        }
+        resampled += count;
+    });
+
+    /* Second pass: output ranges of the long polylines. */
+    struct RangeTask
+    {
+        size_t longIndex;
+        size_t first;
+        size_t last;
+    };
+    std::vector<RangeTask> rangeTasks;
+    for (size_t l = 0; l < longPolylines.size(); ++l)
+    {
+        const size_t k = longPolylines[l];
+        if (!isValid(k))
+            continue;
+
+        const size_t outputCount = outputPointsCount(dataCounts[k]);
+        for (size_t first = 0; first < outputCount; first += grainSize)
+        {
+            const RangeTask range = { l, first, std::min(outputCount, first + grainSize) };
+            rangeTasks.push_back(range);
+        }
+        ++resampled;
+    }
+
+    detail::parallelFor(rangeTasks.size(), threadCount, [&](const size_t t, const unsigned) {
+        const RangeTask& range = rangeTasks[t];
+        const size_t k = longPolylines[range.longIndex];
+        const Span<const Real> dists(longDists.data() + longDistsOffsets[range.longIndex],
+                                      offsets[k + 1] - offsets[k]);
+
+        resampleArcLengthRange<P, Real>(input(k), dists, arcLengthStep(dists, dataCounts[k]),
+            range.first, range.last, outputPoints.data + outputOffsets[k]);
+    });
+
+    return resampled;
+}
+
+}
@@ -0,0 +1,124 @@
+#include "lineSplitterParallel.h"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+/* Checks that resampleArcLengthBatchParallel() outputs exactly the bytes of
+ * resampleArcLengthBatch() whatever the number of threads and the grain size:
+ * mixed polylines of 0 to 200k vertices, some longer than the grain size
+ * (resampled by several range tasks), some invalid (0 or 1 vertex, dataCount
+ * 0 or negative) whose output slots must be left untouched. Returns non-zero
+ * on failure.
+ */
+
+namespace
+{
+
+typedef LineSplitter::Point2<double> Point;
+
+struct Batch
+{
+    std::vector<Point> points;
+    std::vector<size_t> offsets;
+    std::vector<int> dataCounts;
+    std::vector<size_t> outputOffsets;
+    size_t outputCount;
+};
+
+Batch makeBatch()
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> step(-10., 10.);
+    std::uniform_int_distribution<size_t> smallSize(2, 5000);
+
+    std::vector<size_t> sizes = { 0, 1, 2, 3, 1, 0, 200000, 17, 100000 };
+    for (int k = 0; k < 200; ++k)
+        sizes.push_back(smallSize(rng));
+
+    Batch batch;
+    batch.offsets.push_back(0);
+    for (size_t k = 0; k < sizes.size(); ++k)
+    {
+        Point p = { 0., 0. };
+        for (size_t i = 0; i < sizes[k]; ++i)
+        {
+            // every 5th vertex repeated: zero-length segments
+            if (i % 5 != 4)
+            {
+                p.x += step(rng);
+                p.y += step(rng);
+            }
+            batch.points.push_back(p);
+        }
+        batch.offsets.push_back(batch.points.size());
+
+        // dataCount 0 or negative every 7 polylines, more points than vertices every 3
+        const int n = int(sizes[k]);
+        batch.dataCounts.push_back(k % 7 == 5 ? -int(k % 2) : (k % 3 == 0 ? 3 * n + 1 : n / 2 + 1));
+    }
+
+    batch.outputOffsets.resize(batch.dataCounts.size() + 1);
+    batch.outputCount = LineSplitter::batchOutputOffsets(LineSplitter::makeSpan(batch.dataCounts),
+        LineSplitter::makeSpan(batch.outputOffsets));
+    return batch;
+}
+
+}
+
+int main()
+{
+    int failures = 0;
+    const Batch batch = makeBatch();
+
+    // sentinel: the output slots of the invalid polylines must keep it
+    const Point sentinel = { -1234.5, 6789.25 };
+    std::vector<Point> expected(batch.outputCount, sentinel);
+    const size_t expectedResampled = LineSplitter::resampleArcLengthBatch<Point>(LineSplitter::makeSpan(batch.points),
+        LineSplitter::makeSpan(batch.offsets), LineSplitter::makeSpan(batch.dataCounts),
+        LineSplitter::makeSpan(expected), LineSplitter::makeSpan(batch.outputOffsets));
+
+    // the reference itself: invalid polylines untouched, the others overwritten
+    size_t invalid = 0;
+    for (size_t k = 0; k + 1 < batch.offsets.size(); ++k)
+        if (batch.offsets[k + 1] - batch.offsets[k] < 2 || batch.dataCounts[k] < 1)
+        {
+            ++invalid;
+            for (size_t i = batch.outputOffsets[k]; i < batch.outputOffsets[k + 1]; ++i)
+                if (std::memcmp(&expected[i], &sentinel, sizeof(Point)) != 0)
+                {
+                    std::fprintf(stderr, "FAIL polyline %zu is invalid but its output was written\n", k);
+                    ++failures;
+                    break;
+                }
+        }
+    if (invalid == 0 || expectedResampled + invalid != batch.dataCounts.size())
+    {
+        std::fprintf(stderr, "FAIL %zu polylines resampled, %zu invalid out of %zu\n", expectedResampled, invalid,
+            batch.dataCounts.size());
+        ++failures;
+    }
+
+    for (const unsigned threadCount : { 1u, 2u, 3u, 7u, 32u })
+        for (const size_t grainSize : { size_t(16384), size_t(1000), size_t(1) })
+        {
+            std::vector<Point> output(batch.outputCount, sentinel);
+            const size_t resampled = LineSplitter::resampleArcLengthBatchParallel<Point>(
+                LineSplitter::makeSpan(batch.points), LineSplitter::makeSpan(batch.offsets),
+                LineSplitter::makeSpan(batch.dataCounts), LineSplitter::makeSpan(output),
+                LineSplitter::makeSpan(batch.outputOffsets), threadCount, grainSize);
+
+            if (resampled != expectedResampled
+                || std::memcmp(output.data(), expected.data(), output.size() * sizeof(Point)) != 0)
+            {
+                std::fprintf(stderr, "FAIL %u threads, grain size %zu: output differs from the single-threaded one\n",
+                    threadCount, grainSize);
+                ++failures;
+            }
+        }
+
+    std::printf("%zu polylines, %zu output points, %d failure(s)\n", batch.dataCounts.size(), batch.outputCount,
+        failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Three-stage streaming pipeline: read -> process -> write, one thread per
+ * stage, so the I/O of the first and last stages overlaps the computations of
+ * the middle one.
+ *
+ * The chunks are allocated once and recycled: a chunk goes through the stages
+ * and back to the reader, which waits for a free chunk when they are all in
+ * flight. Memory is thus bounded by 'chunkCount' chunks, whatever the size of
+ * the input. Chunks are written in the order they are read.
+ */
+namespace LineSplitter
+{
+
+/* Bounded blocking FIFO between two threads. */
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(const size_t capacity) : _capacity(capacity ? capacity : 1), _closed(false) {}
+
+    /* Blocks while the queue is full. False if the queue is closed. */
+    bool push(T value)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _notFull.wait(lock, [&] { return _items.size() < _capacity || _closed; });
+        if (_closed)
+            return false;
+        _items.push_back(std::move(value));
+        _notEmpty.notify_one();
+        return true;
+    }
+
+    /* Blocks while the queue is empty. False once it is closed and empty. */
+    bool pop(T& value)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _notEmpty.wait(lock, [&] { return !_items.empty() || _closed; });
+        if (_items.empty())
+            return false;
+        value = std::move(_items.front());
+        _items.pop_front();
+        _notFull.notify_one();
+        return true;
+    }
+
+    /* No more push(): pop() drains what's left, then fails. */
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _closed = true;
+        _notEmpty.notify_all();
+        _notFull.notify_all();
+    }
+
+private:
+    std::mutex _mutex;
+    std::condition_variable _notFull;
+    std::condition_variable _notEmpty;
+    std::deque<T> _items;
+    size_t _capacity;
+    bool _closed;
+};
+
+/* What a stage did: 'busySeconds' in the stage function, 'waitSeconds'
+ * blocked on its queues. 'units' and 'bytes' are counted by the stage
+ * function itself (polylines, points...). The stage with the largest busy
+ * time is the bottleneck; the others mostly wait. */
+struct StageCounters
+{
+    size_t chunks = 0;
+    size_t units = 0;
+    size_t bytes = 0;
+    double busySeconds = 0.;
+    double waitSeconds = 0.;
+
+    double unitsPerSecond() const { return busySeconds > 0. ? units / busySeconds : 0.; }
+    double bytesPerSecond() const { return busySeconds > 0. ? bytes / busySeconds : 0.; }
+};
+
+struct PipelineCounters
+{
+    StageCounters read;
+    StageCounters process;
+    StageCounters write;
+    double seconds = 0.; // wall clock
+};
+
+/* Runs the pipeline until read() returns false, over 'chunkCount' chunks
+ * (2 at least: one being read while another is processed, 3 or more to also
+ * overlap the writes).
+ *
+ *   bool read(Chunk&, StageCounters&)     fills the chunk, false at the end of the input
+ *   bool process(Chunk&, StageCounters&)  false on error
+ *   bool write(Chunk&, StageCounters&)    false on error
+ *
+ * read() also returns false on a read error (the caller keeps track of it):
+ * the chunks already read are still processed and written. An error of
+ * process() or write() stops the pipeline: the chunks in flight are dropped.
+ * Returns false if process() or write() failed.
+ */
+template <typename Chunk, typename Read, typename Process, typename Write>
+bool runPipeline(Read read, Process process, Write write, const size_t chunkCount, PipelineCounters& counters)
+{
+    typedef std::chrono::steady_clock Clock;
+    auto seconds = [](const Clock::time_point from) {
+        return std::chrono::duration<double>(Clock::now() - from).count();
+    };
+
+    std::vector<Chunk> chunks(chunkCount < 2 ? 2 : chunkCount);
+    BoundedQueue<Chunk*> freeChunks(chunks.size());
+    BoundedQueue<Chunk*> toProcess(chunks.size());
+    BoundedQueue<Chunk*> toWrite(chunks.size());
+    for (Chunk& chunk : chunks)
+        freeChunks.push(&chunk);
+
+    std::atomic<bool> failed(false);
+    const Clock::time_point start = Clock::now();
+
+    // pops from 'input', runs 'fn' and pushes to 'output' until 'input' is drained
+    auto stage = [&](BoundedQueue<Chunk*>& input, BoundedQueue<Chunk*>& output, StageCounters& c, auto fn) {
+        for (;;)
+        {
+            Clock::time_point t = Clock::now();
+            Chunk* chunk;
+            if (!input.pop(chunk))
+                break;
+            c.waitSeconds += seconds(t);
+
+            t = Clock::now();
+            const bool ok = !failed && fn(*chunk, c);
+            c.busySeconds += seconds(t);
+            c.chunks += ok;
+            if (!ok)
+                failed = true;
+
+            t = Clock::now();
+            output.push(chunk);
+            c.waitSeconds += seconds(t);
+        }
+        output.close();
+    };
+
+    std::thread processThread([&] {
+        stage(toProcess, toWrite, counters.process, [&](Chunk& chunk, StageCounters& c) { return process(chunk, c); });
+    });
+    std::thread writeThread([&] {
+        stage(toWrite, freeChunks, counters.write, [&](Chunk& chunk, StageCounters& c) { return write(chunk, c); });
+    });
+
+    // the reader stops at the end of the input or at the first error
+    for (;;)
+    {
+        Clock::time_point t = Clock::now();
+        Chunk* chunk;
+        if (failed || !freeChunks.pop(chunk) || failed)
+            break;
+        counters.read.waitSeconds += seconds(t);
+
+        t = Clock::now();
+        const bool more = read(*chunk, counters.read);
+        counters.read.busySeconds += seconds(t);
+        if (!more)
+            break;
+        ++counters.read.chunks;
+        toProcess.push(chunk);
+    }
+    toProcess.close();
+
+    processThread.join();
+    writeThread.join();
+    counters.seconds = seconds(start);
+    return !failed;
+}
+
+}
@@ -0,0 +1,328 @@
+#pragma once
+
+#include "lineSplitter.h"
+
+#include <type_traits>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define LINESPLITTER_SIMD_X86
+#include <immintrin.h>
+#endif
+
+/* SIMD kernels (SSE4/AVX2, chosen at runtime) for the arc-length resampler:
+ * segment lengths, prefix sum of the lengths and interpolation of the output
+ * points. They work on points stored as two consecutive doubles (x, y).
+ *
+ * Segment lengths and interpolated points are bit-identical to the scalar
+ * code, and so is the whole output with SimdLevel::Scalar. The vectorized
+ * prefix sum adds the lengths in a different order, so with SSE4/AVX2 the
+ * cumulative distances (and thus the output points) differ from
+ * resampleArcLength() by the float rounding error of the sum. For a polyline
+ * of n vertices and length L, every output point is within
+ * 4 * (n - 1) * 2^-24 * L of the scalar one (both sums err by at most
+ * (n - 1) * 2^-24 * L, the step as much). In practice the error grows like
+ * sqrt(n): below 2e-5 * L up to 1e6 vertices (about 7e-6 * L for a 1e5
+ * vertices random walk). See lineSplitterSimdTest.cpp.
+ * The cumulative distances are always stored in floats (FloatPrecision).
+ *
+ * Only GCC/Clang on x86 get the SIMD versions, other compilers use the scalar
+ * fallback.
+ */
+namespace LineSplitter
+{
+
+enum class SimdLevel
+{
+    Scalar,
+    SSE4,
+    AVX2
+};
+
+inline SimdLevel detectSimdLevel()
+{
+#ifdef LINESPLITTER_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse4.1"))
+        return SimdLevel::SSE4;
+#endif
+    return SimdLevel::Scalar;
+}
+
+/* Best level supported by the CPU, detected once. */
+inline SimdLevel simdLevel()
+{
+    static const SimdLevel level = detectSimdLevel();
+    return level;
+}
+
+/* Point types laid out as two consecutive doubles (x, y). */
+template <typename P>
+struct IsPackedDoublePoint : std::false_type
+{
+};
+
+template <>
+struct IsPackedDoublePoint<Point2<double> > : std::true_type
+{
+};
+
+namespace detail
+{
+
+/* lengths[i - 1] = length of the segment (i - 1, i), for i in [first, pointsCount) */
+inline void segmentLengthsScalar(const double* xy, size_t first, const size_t pointsCount, float* lengths)
+{
+    for (size_t i = first; i < pointsCount; ++i)
+    {
+        const double dx = xy[2 * i] - xy[2 * i - 2];
+        const double dy = xy[2 * i + 1] - xy[2 * i - 1];
+        lengths[i - 1] = float(std::sqrt(dx * dx + dy * dy));
+    }
+}
+
+/* values[i] = carry + values[0] + ... + values[i], returns the new carry */
+inline float prefixSumScalar(float* values, const size_t count, float carry)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        carry = carry + values[i];
+        values[i] = carry;
+    }
+    return carry;
+}
+
+/* out[j] = (1 - t[j]) * p[segments[j] - 1] + t[j] * p[segments[j]] */
+inline void lerpPointsScalar(const double* xy, const size_t* segments, const float* t, const size_t count, double* out)
+{
+    for (size_t j = 0; j < count; ++j)
+    {
+        const double* a = xy + 2 * (segments[j] - 1);
+        const double* b = a + 2;
+        const double u = double(1 - t[j]);
+        const double v = t[j];
+        out[2 * j] = u * a[0] + v * b[0];
+        out[2 * j + 1] = u * a[1] + v * b[1];
+    }
+}
+
+#ifdef LINESPLITTER_SIMD_X86
+
+__attribute__((target("sse4.1"))) inline void segmentLengthsSse4(const double* xy, const size_t pointsCount, float* lengths)
+{
+    size_t i = 1;
+    for (; i + 1 < pointsCount; i += 2)
+    {
+        const __m128d p0 = _mm_loadu_pd(xy + 2 * i - 2);
+        const __m128d p1 = _mm_loadu_pd(xy + 2 * i);
+        const __m128d p2 = _mm_loadu_pd(xy + 2 * i + 2);
+        const __m128d d0 = _mm_sub_pd(p1, p0);
+        const __m128d d1 = _mm_sub_pd(p2, p1);
+        const __m128d squares = _mm_hadd_pd(_mm_mul_pd(d0, d0), _mm_mul_pd(d1, d1));
+        _mm_storel_pi(reinterpret_cast<__m64*>(lengths + i - 1), _mm_cvtpd_ps(_mm_sqrt_pd(squares)));
+    }
+    segmentLengthsScalar(xy, i, pointsCount, lengths);
+}
+
+__attribute__((target("sse4.1"))) inline float prefixSumSse4(float* values, const size_t count, float carry)
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(values + i);
+        x = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 4)));
+        x = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 8)));
+        x = _mm_add_ps(x, _mm_set1_ps(carry));
+        _mm_storeu_ps(values + i, x);
+        carry = _mm_cvtss_f32(_mm_shuffle_ps(x, x, _MM_SHUFFLE(3, 3, 3, 3)));
+    }
+    return prefixSumScalar(values + i, count - i, carry);
+}
+
+__attribute__((target("sse4.1"))) inline void lerpPointsSse4(const double* xy, const size_t* segments, const float* t, const size_t count, double* out)
+{
+    for (size_t j = 0; j < count; ++j)
+    {
+        const double* a = xy + 2 * (segments[j] - 1);
+        const __m128d u = _mm_set1_pd(double(1 - t[j]));
+        const __m128d v = _mm_set1_pd(double(t[j]));
+        const __m128d r = _mm_add_pd(_mm_mul_pd(u, _mm_loadu_pd(a)), _mm_mul_pd(v, _mm_loadu_pd(a + 2)));
+        _mm_storeu_pd(out + 2 * j, r);
+    }
+}
+
+__attribute__((target("avx2"))) inline void segmentLengthsAvx2(const double* xy, const size_t pointsCount, float* lengths)
+{
+    size_t i = 1;
+    for (; i + 3 < pointsCount; i += 4)
+    {
+        // segments (i - 1, i), (i, i + 1) and (i + 1, i + 2), (i + 2, i + 3)
+        const __m256d d01 = _mm256_sub_pd(_mm256_loadu_pd(xy + 2 * i), _mm256_loadu_pd(xy + 2 * i - 2));
+        const __m256d d23 = _mm256_sub_pd(_mm256_loadu_pd(xy + 2 * i + 4), _mm256_loadu_pd(xy + 2 * i + 2));
+        // hadd gives [s0, s2, s1, s3]
+        __m256d squares = _mm256_hadd_pd(_mm256_mul_pd(d01, d01), _mm256_mul_pd(d23, d23));
+        squares = _mm256_permute4x64_pd(squares, _MM_SHUFFLE(3, 1, 2, 0));
+        _mm_storeu_ps(lengths + i - 1, _mm256_cvtpd_ps(_mm256_sqrt_pd(squares)));
+    }
+    segmentLengthsScalar(xy, i, pointsCount, lengths);
+}
+
+__attribute__((target("avx2"))) inline float prefixSumAvx2(float* values, const size_t count, float carry)
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(values + i);
+        // scan within each 128-bit lane
+        x = _mm256_add_ps(x, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(x), 4)));
+        x = _mm256_add_ps(x, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(x), 8)));
+        // add the total of the low lane to the high lane
+        __m256 lowTotal = _mm256_permute_ps(x, _MM_SHUFFLE(3, 3, 3, 3));
+        lowTotal = _mm256_permute2f128_ps(lowTotal, lowTotal, 0x08);
+        x = _mm256_add_ps(x, lowTotal);
+        x = _mm256_add_ps(x, _mm256_set1_ps(carry));
+        _mm256_storeu_ps(values + i, x);
+        carry = _mm_cvtss_f32(_mm_permute_ps(_mm256_extractf128_ps(x, 1), _MM_SHUFFLE(3, 3, 3, 3)));
+    }
+    return prefixSumScalar(values + i, count - i, carry);
+}
+
+__attribute__((target("avx2"))) inline void lerpPointsAvx2(const double* xy, const size_t* segments, const float* t, const size_t count, double* out)
+{
+    size_t j = 0;
+    for (; j + 2 <= count; j += 2)
+    {
+        const double* a0 = xy + 2 * (segments[j] - 1);
+        const double* a1 = xy + 2 * (segments[j + 1] - 1);
+        const __m256d a = _mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_loadu_pd(a0)), _mm_loadu_pd(a1), 1);
+        const __m256d b = _mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_loadu_pd(a0 + 2)), _mm_loadu_pd(a1 + 2), 1);
+        const double u0 = double(1 - t[j]), u1 = double(1 - t[j + 1]);
+        const double v0 = t[j], v1 = t[j + 1];
+        const __m256d u = _mm256_set_pd(u1, u1, u0, u0);
+        const __m256d v = _mm256_set_pd(v1, v1, v0, v0);
+        _mm256_storeu_pd(out + 2 * j, _mm256_add_pd(_mm256_mul_pd(u, a), _mm256_mul_pd(v, b)));
+    }
+    lerpPointsScalar(xy, segments + j, t + j, count - j, out + 2 * j);
+}
+
+#endif
+
+}
+
+inline void segmentLengths(const double* xy, const size_t pointsCount, float* lengths, const SimdLevel level = simdLevel())
+{
+#ifdef LINESPLITTER_SIMD_X86
+    if (level == SimdLevel::AVX2)
+        return detail::segmentLengthsAvx2(xy, pointsCount, lengths);
+    if (level == SimdLevel::SSE4)
+        return detail::segmentLengthsSse4(xy, pointsCount, lengths);
+#endif
+    (void)level;
+    detail::segmentLengthsScalar(xy, 1, pointsCount, lengths);
+}
+
+inline float prefixSum(float* values, const size_t count, const float carry, const SimdLevel level = simdLevel())
+{
+#ifdef LINESPLITTER_SIMD_X86
+    if (level == SimdLevel::AVX2)
+        return detail::prefixSumAvx2(values, count, carry);
+    if (level == SimdLevel::SSE4)
+        return detail::prefixSumSse4(values, count, carry);
+#endif
+    (void)level;
+    return detail::prefixSumScalar(values, count, carry);
+}
+
+inline void lerpPoints(const double* xy, const size_t* segments, const float* t, const size_t count, double* out,
+    const SimdLevel level = simdLevel())
+{
+#ifdef LINESPLITTER_SIMD_X86
+    if (level == SimdLevel::AVX2)
+        return detail::lerpPointsAvx2(xy, segments, t, count, out);
+    if (level == SimdLevel::SSE4)
+        return detail::lerpPointsSse4(xy, segments, t, count, out);
+#endif
+    (void)level;
+    detail::lerpPointsScalar(xy, segments, t, count, out);
+}
+
+/* resampleArcLength() using the SIMD kernels. 'level' must be supported by
+ * the CPU (the default is the best supported one). Point types that are not
+ * packed doubles use resampleArcLength().
+ */
+template <typename P>
+typename std::enable_if<!IsPackedDoublePoint<P>::value, size_t>::type
+resampleArcLengthSimd(Span<const typename NonDeduced<P>::type> input, const int dataCount, Span<P> output, Span<float> dists,
+    const SimdLevel = simdLevel())
+{
+    return resampleArcLength<P>(input, dataCount, output, dists);
+}
+
+template <typename P>
+typename std::enable_if<IsPackedDoublePoint<P>::value, size_t>::type
+resampleArcLengthSimd(Span<const typename NonDeduced<P>::type> input, const int dataCount, Span<P> output, Span<float> dists,
+    const SimdLevel level = simdLevel())
+{
+    static_assert(sizeof(P) == 2 * sizeof(double), "points must be two consecutive doubles");
+
+    const size_t outputCount = outputPointsCount(dataCount);
+    if (input.size < 2 || outputCount == 0 || output.size < outputCount || dists.size < input.size)
+        return 0;
+
+    const double* xy = reinterpret_cast<const double*>(input.data);
+    double* outXY = reinterpret_cast<double*>(output.data);
+
+    /* cumulative distances */
+    dists[0] = 0;
+    segmentLengths(xy, input.size, dists.data + 1, level);
+    prefixSum(dists.data + 1, input.size - 1, 0.f, level);
+
+    const Span<const float> inputDists(dists.data, input.size);
+    const float step = arcLengthStep(inputDists, dataCount);
+    output[0] = input[0];
+
+    // all the points are the same (step = 0): nothing to interpolate along
+    if (!(dists[input.size - 1] > 0))
+    {
+        for (size_t i = 1; i < outputCount; ++i)
+            output[i] = input[0];
+        return outputCount;
+    }
+
+    /* find the segments of a block of output points, then interpolate them */
+    const size_t blockSize = 256;
+    size_t segments[blockSize];
+    float t[blockSize];
+
+    size_t segment_idx = 1;
+    size_t i = 1;
+    while (i < outputCount)
+    {
+        const size_t blockEnd = std::min(outputCount, i + blockSize);
+        size_t count = 0;
+        for (; i < blockEnd; ++i, ++count)
+        {
+            const float total_dist = float(i) * step;
+            while (segment_idx < input.size && total_dist > dists[segment_idx])
+                ++segment_idx;
+            if (segment_idx == input.size)
+                break;
+
+            segments[count] = segment_idx;
+            t[count] = (total_dist - dists[segment_idx - 1]) / (dists[segment_idx] - dists[segment_idx - 1]);
+        }
+        lerpPoints(xy, segments, t, count, outXY + 2 * (i - count), level);
+
+        if (segment_idx == input.size)
+            break;
+    }
+
+    // float rounding may overshoot the total length: pad with the last point
+    for (; i < outputCount; ++i)
+        output[i] = input[input.size - 1];
+
+    return outputCount;
+}
+
+}
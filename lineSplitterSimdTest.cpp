@@ -0,0 +1,123 @@
+#include "lineSplitterSimd.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+/* Compares resampleArcLengthSimd() at every level the CPU supports with
+ * resampleArcLength(): bit-identical with SimdLevel::Scalar, within the bound
+ * stated in lineSplitterSimd.h with SSE4/AVX2. Returns non-zero on failure.
+ */
+
+namespace
+{
+
+typedef LineSplitter::Point2<double> Point;
+
+// random walk, every 'repeat'-th vertex repeated (zero-length segment) if 'repeat' > 0
+std::vector<Point> makeRandomWalk(const size_t count, const size_t repeat)
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> step(-10., 10.);
+    std::vector<Point> points(count);
+    points[0].x = points[0].y = 0.;
+    for (size_t i = 1; i < count; ++i)
+    {
+        points[i] = points[i - 1];
+        if (repeat == 0 || i % repeat != 0)
+        {
+            points[i].x += step(rng);
+            points[i].y += step(rng);
+        }
+    }
+    return points;
+}
+
+const char* levelName(const LineSplitter::SimdLevel level)
+{
+    switch (level)
+    {
+    case LineSplitter::SimdLevel::SSE4:
+        return "SSE4";
+    case LineSplitter::SimdLevel::AVX2:
+        return "AVX2";
+    default:
+        return "Scalar";
+    }
+}
+
+int g_failures = 0;
+
+void check(const std::vector<Point>& input, const int dataCount, const LineSplitter::SimdLevel level)
+{
+    const size_t n = input.size();
+    std::vector<Point> expected(LineSplitter::outputPointsCount(dataCount));
+    std::vector<Point> output(expected.size());
+    std::vector<float> dists(n);
+
+    const size_t expectedCount = LineSplitter::resampleArcLength<Point>(LineSplitter::makeSpan(input), dataCount,
+        LineSplitter::makeSpan(expected));
+    const size_t count = LineSplitter::resampleArcLengthSimd<Point>(LineSplitter::makeSpan(input), dataCount,
+        LineSplitter::makeSpan(output), LineSplitter::makeSpan(dists), level);
+    if (count != expectedCount)
+    {
+        std::fprintf(stderr, "FAIL %s, %zu vertices, %d data: %zu points instead of %zu\n", levelName(level), n,
+            dataCount, count, expectedCount);
+        ++g_failures;
+        return;
+    }
+
+    double length = 0.;
+    for (size_t i = 1; i < n; ++i)
+        length += LineSplitter::distance(input[i - 1], input[i]);
+
+    double error = 0.;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const double e = std::hypot(output[i].x - expected[i].x, output[i].y - expected[i].y);
+        error = std::isnan(e) ? HUGE_VAL : std::max(error, e);
+    }
+
+    // bounds of lineSplitterSimd.h
+    const double unitRoundoff = std::ldexp(1., -24);
+    double bound = std::min(4. * double(n - 1) * unitRoundoff, n <= 1000000 ? 2e-5 : 1.) * length;
+    if (level == LineSplitter::SimdLevel::Scalar)
+        bound = 0.;
+    if (!(error <= bound))
+    {
+        std::fprintf(stderr, "FAIL %s, %zu vertices, %d data: error %g > %g (length %g)\n", levelName(level), n,
+            dataCount, error, bound, length);
+        ++g_failures;
+    }
+}
+
+}
+
+int main()
+{
+    std::vector<LineSplitter::SimdLevel> levels(1, LineSplitter::SimdLevel::Scalar);
+    if (LineSplitter::simdLevel() >= LineSplitter::SimdLevel::SSE4)
+        levels.push_back(LineSplitter::SimdLevel::SSE4);
+    if (LineSplitter::simdLevel() >= LineSplitter::SimdLevel::AVX2)
+        levels.push_back(LineSplitter::SimdLevel::AVX2);
+
+    // sizes around the vector widths (tails of the kernels) up to 1e6 vertices
+    const size_t sizes[] = { 2, 3, 4, 5, 8, 9, 16, 17, 33, 1000, 100000, 1000000 };
+    for (const LineSplitter::SimdLevel level : levels)
+        for (const size_t n : sizes)
+            for (const size_t repeat : { 0, 3 })
+            {
+                const std::vector<Point> input = makeRandomWalk(n, repeat);
+                for (const int dataCount : { 1, 7, 255, 256, 257, int(n), int(3 * n) })
+                    if (n < 100000 || dataCount == 7 || dataCount == int(n))
+                        check(input, dataCount, level);
+            }
+
+    // polyline of length 0: the first point everywhere, no NaN
+    for (const LineSplitter::SimdLevel level : levels)
+        check(std::vector<Point>(100, Point{ 3., 4. }), 10, level);
+
+    std::printf("%zu SIMD level(s) checked, %d failure(s)\n", levels.size(), g_failures);
+    return g_failures == 0 ? 0 : 1;
+}
@@ -1,83 +1,181 @@
 #include "mainwindow.h"
 #include "./ui_mainwindow.h"
 
+#include "lineSplitter.h"
+#include "segmentRasterizer.h"
+
 #include <algorithm>
 #include <cmath>
 #include <numeric>
 
+#include <QImage>
+#include <QKeyEvent>
+#include <QMouseEvent>
 #include <QPaintEvent>
 #include <QPainter>
-#include <QtMath>
-#include <QVector2D>
+#include <QStatusBar>
+#include <QWheelEvent>
 
-void createNewPointsAndLinesForData(const QPolygonF& inputPoints,
-    const int dataCount,
-    QPolygonF& outputPoints,
-    QVector<QLineF>& outputLines);
-void lightxbulbCode(const QPolygonF& inputPoints,
-    const int dataCount,
-    QPolygonF& outputPoints,
-    QVector<QLineF>& outputLines);
+namespace LineSplitter
+{
+template <>
+struct PointTraits<QPointF>
+{
+    typedef qreal Scalar;
 
-void lightxbulbCode(const QPolygonF& inputPoints,
-    const int dataCount,
-    QPolygonF& outputPoints,
-    QVector<QLineF>& outputLines)
+    static qreal x(const QPointF& p) { return p.x(); }
+    static qreal y(const QPointF& p) { return p.y(); }
+    static QPointF make(qreal x, qreal y) { return QPointF(x, y); }
+};
+}
+
+static LineSplitter::Span<const QPointF> pointsSpan(const QPolygonF& points)
+{
+    return LineSplitter::Span<const QPointF>(points.constData(), size_t(points.size()));
+}
+
+// segments (points[indices[i]], points[indices[i] + 1]) scaled by 'zoom', as
+// read by rasterizeSegments()
+class ZoomedSegments
 {
-    outputPoints.resize(dataCount + 1);
-
-    /* cumulative distances */
-    QVector<float> dists(inputPoints.size());
-    dists[0] = 0;
-    for (int i = 1; i < inputPoints.size(); ++i)
-        dists[i] = dists[i - 1] + QLineF(inputPoints[i], inputPoints[i - 1]).length();
-
-    /* step size */
-    float step = dists.back() / (dataCount - 1);
-    outputPoints[0] = inputPoints[0];
-    float total_dist = 0;
-    int segment_idx = 1;
-    int i;
-    for (i = 1; i < outputPoints.size(); ++i)
+public:
+    typedef QPointF Point;
+
+    ZoomedSegments(const QPolygonF& points, const std::vector<uint32_t>& indices, const double zoom) :
+        _points(points), _indices(indices), _zoom(zoom)
     {
-        total_dist = total_dist + step;
-        while (total_dist > dists[segment_idx])
-        {
-            ++segment_idx;
-            if (segment_idx == inputPoints.size())
-                goto end;
-        }
-        float t = (total_dist - dists[segment_idx - 1]) / (dists[segment_idx] - dists[segment_idx - 1]);
-        outputPoints[i] = (1 - t) * inputPoints[segment_idx - 1] + t * inputPoints[segment_idx];
     }
-end:
-    if (i < outputPoints.size())
+
+    size_t size() const { return _indices.size(); }
+    QPointF p1(const size_t i) const { return _points[int(_indices[i])] * _zoom; }
+    QPointF p2(const size_t i) const { return _points[int(_indices[i]) + 1] * _zoom; }
+
+private:
+    const QPolygonF& _points;
+    const std::vector<uint32_t>& _indices;
+    double _zoom;
+};
+
+// segments 'indices' of the polyline 'points' scaled by 'zoom', segment i
+// colored with data[i], rasterized in an image of 'size' logical pixels (on
+// all the cores), 'ratio' device pixels per logical pixel
+static QImage renderColoredSegments(const QPolygonF& points, const QVector<double>& data,
+    const std::vector<uint32_t>& indices, const CompiledColorMap& colorMap, const QSize& size,
+    const double lineWidth, const double zoom, const qreal ratio)
+{
+    QImage image(size * ratio, QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(ratio);
+    image.fill(Qt::transparent);
+
+    QVector<double> values(int(indices.size()));
+    for (int k = 0; k < values.size(); ++k)
+        values[k] = data[int(indices[k])];
+    QVector<QRgb> colors(values.size());
+    colorMap.mapBatch(colorMap.min(), colorMap.max(), values.constData(), colors.data(), size_t(colors.size()));
+
+    const LineSplitter::RasterImage target = { reinterpret_cast<uint32_t*>(image.bits()),
+        image.width(), image.height(), size_t(image.bytesPerLine()) / sizeof(uint32_t) };
+    LineSplitter::rasterizeSegments(ZoomedSegments(points, indices, zoom * ratio),
+        LineSplitter::Span<const uint32_t>(colors.constData(), size_t(colors.size())), lineWidth * ratio, target);
+
+    return image;
+}
+
+// lines 'indices', line i colored with data[i], quantized to the nearest
+// color of 'palette' (sampled from [min, max]): the lines of each color are
+// gathered and drawn with a single pen and drawLines() call
+static void drawBucketedLines(QPainter& painter, const QVector<QLineF>& lines, const QVector<double>& data,
+    const std::vector<uint32_t>& indices, const double min, const double max, const QVector<QRgb>& palette,
+    const int lineWidth)
+{
+    const int bucketCount = palette.size();
+    const int count = int(indices.size());
+    if (bucketCount < 2 || count == 0 || !(max > min))
+        return;
+
+    // counting sort of the lines by bucket (NaN values are not drawn)
+    const double scale = (bucketCount - 1) / (max - min);
+    QVector<int> buckets(count);
+    QVector<int> offsets(bucketCount + 1, 0);
+    for (int i = 0; i < count; ++i)
     {
-        outputPoints[i++] = inputPoints.back();
-        segment_idx = inputPoints.size() - 1;
-        while (i < outputPoints.size())
-        {
-            total_dist = total_dist + step;            
-            float t = (total_dist - dists[segment_idx - 1]) / (dists[segment_idx] - dists[segment_idx - 1]);
-            outputPoints[i] = (1 - t) * inputPoints.back() + t * inputPoints.back();
-            i += 1;
-        }
+        const double index = (data[int(indices[i])] - min) * scale;
+        buckets[i] = qIsNaN(index) ? -1 : int(qBound(0.0, index, bucketCount - 1.0) + 0.5);
+        if (buckets[i] >= 0)
+            ++offsets[buckets[i] + 1];
     }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
 
-createLines:
-    for (int i = 0; i < outputPoints.size() - 1; i++)
+    QVector<QLineF> sortedLines(offsets[bucketCount]);
+    QVector<int> cursor = offsets;
+    for (int i = 0; i < count; ++i)
     {
-        outputLines.push_back(QLineF(outputPoints[i], outputPoints[i + 1]));
+        if (buckets[i] >= 0)
+            sortedLines[cursor[buckets[i]]++] = lines[int(indices[i])];
+    }
+
+    QPen pen;
+    pen.setCapStyle(Qt::RoundCap);
+    pen.setWidth(lineWidth);
+    pen.setCosmetic(true); // same width whatever the zoom
+    for (int b = 0; b < bucketCount; ++b)
+    {
+        if (offsets[b] == offsets[b + 1])
+            continue;
+
+        pen.setColor(QColor::fromRgba(palette[b]));
+        painter.setPen(pen);
+        painter.drawLines(sortedLines.constData() + offsets[b], offsets[b + 1] - offsets[b]);
     }
 }
 
-double linesLengthBetween2Points(const QPolygonF& pointsSet, const int p1, const int p2);
+static void createLines(const QPolygonF& points, QVector<QLineF>& outputLines)
+{
+    if (points.size() < 2)
+        return;
+
+    outputLines.reserve(outputLines.size() + points.size() - 1);
+    for (int i = 0; i < points.size() - 1; i++)
+    {
+        outputLines.push_back(QLineF(points[i], points[i + 1]));
+    }
+}
+
+void lightxbulbCode(const QPolygonF& inputPoints,
+    const int dataCount,
+    QPolygonF& outputPoints,
+    QVector<QLineF>& outputLines)
+{
+    outputPoints.resize(int(LineSplitter::outputPointsCount(dataCount)));
+
+    const size_t count = LineSplitter::resampleArcLength(pointsSpan(inputPoints), dataCount,
+        LineSplitter::Span<QPointF>(outputPoints.data(), size_t(outputPoints.size())));
+    outputPoints.resize(int(count));
+
+    createLines(outputPoints, outputLines);
+}
+
+// NB: inputPoints mustn't contain identical consecutive points
+void createNewPointsAndLinesForData(const QPolygonF& inputPoints, const int dataCount,
+    QPolygonF& outputPoints, QVector<QLineF>& outputLines)
+{
+    outputPoints.resize(int(LineSplitter::outputPointsCount(dataCount)));
+    outputLines.clear();
+
+    const size_t count = LineSplitter::splitSegments(pointsSpan(inputPoints), dataCount,
+        LineSplitter::Span<QPointF>(outputPoints.data(), size_t(outputPoints.size())));
+    outputPoints.resize(int(count));
+
+    createLines(outputPoints, outputLines);
+}
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , _ui(new Ui::MainWindow)
 {
     _ui->setupUi(this);
+    setMouseTracking(true);
+    centralWidget()->setMouseTracking(true);
 
     _data.resize(32);
     //std::srand(time(NULL));
@@ -90,6 +188,12 @@ MainWindow::MainWindow(QWidget *parent)
     _maxData = 32;
 
     _colorMap = ColorMapPresets::controlPointsToLinearColorMap(ColorMapPresets::Jet());
+    compileColorMap();
+
+    _renderMode = RenderMode::Rasterizer;
+    _levelOfDetail = LevelOfDetail::Off;
+    _zoom = 1.;
+    _dataPyramid.build(LineSplitter::Span<const double>(_data.constData(), size_t(_data.size())));
 
     _points.push_back(QPointF(20, 30));
     _points.push_back(QPointF(45, 40));
@@ -98,12 +202,7 @@ MainWindow::MainWindow(QWidget *parent)
     _points.push_back(QPointF(150, 300));
     _points.push_back(QPointF(50, 350));
 
-    createNewPointsAndLinesForData(_points, _data.size(), _extendedPoints, _lines);
-    Q_ASSERT(_lines.size() == _data.size());
-
-    lightxbulbCode(_points, _data.size(),
-        _extendedPointsArcLengthParametrization, _linesArcLengthParametrization);
-    Q_ASSERT(_linesArcLengthParametrization.size() == _data.size());
+    resampleLines();
 }
 
 MainWindow::~MainWindow()
@@ -111,238 +210,345 @@ MainWindow::~MainWindow()
     delete _ui;
 }
 
-void MainWindow::paintEvent(QPaintEvent* event)
+MainWindow::RenderMode MainWindow::renderMode() const
 {
-    //setAttribute(Qt::WA_OpaquePaintEvent);
-
-    QPen blackPen(Qt::black);
-    blackPen.setCapStyle(Qt::RoundCap);
-    blackPen.setWidth(5);
-
-    QPen redPen(Qt::red);
-    redPen.setCapStyle(Qt::RoundCap);
-    redPen.setWidth(5);
+    return _renderMode;
+}
 
-    QPen greenPen(Qt::darkGreen);
-    greenPen.setCapStyle(Qt::RoundCap);
-    greenPen.setWidth(5);
+void MainWindow::setRenderMode(const RenderMode mode)
+{
+    if (mode == _renderMode)
+        return;
 
-    QPen bluePen(Qt::blue);
-    bluePen.setCapStyle(Qt::RoundCap);
-    bluePen.setWidth(5);
+    _renderMode = mode;
+    invalidateLayer(ArcLengthLinesLayer);
+    invalidateLayer(LinesLayer);
+}
 
-    QPainter painter(this);
-    painter.setRenderHint(QPainter::Antialiasing, true);
-    painter.drawText(QPoint(15, 20), "Original points set + lightxbulb code");
+void MainWindow::setPoints(const QPolygonF& points)
+{
+    _points = points;
+    resampleLines();
+    invalidateLayers();
+}
 
-    painter.setPen(redPen);
-    for (const auto& pt : _points)
+void MainWindow::setData(const QVector<double>& data)
+{
+    _data = data;
+    _minData = _maxData = 0.;
+    if (!_data.isEmpty())
     {
-        painter.drawPoint(pt);
+        const auto minMax = std::minmax_element(_data.constBegin(), _data.constEnd());
+        _minData = *minMax.first;
+        _maxData = *minMax.second;
     }
 
-    painter.setPen(blackPen);
-    for (const auto& pt : _extendedPointsArcLengthParametrization)
-    {
-        painter.drawPoint(pt);
-    }
+    _dataPyramid.build(LineSplitter::Span<const double>(_data.constData(), size_t(_data.size())));
 
-    painter.setPen(greenPen);
-    //painter.translate(250, 0);
-    painter.drawText(QPoint(15, 20), "Extended points set");
-    for (const auto& pt : _extendedPoints)
-    {
-        painter.drawPoint(pt);
-    }
+    compileColorMap();
+    resampleLines();
+    invalidateLayers();
+}
 
-    painter.setPen(bluePen);
-    painter.translate(250, 0);
-    painter.drawText(QPoint(15, 20), "Coloring lines demo (lightxbulb)");
+MainWindow::LevelOfDetail MainWindow::levelOfDetail() const
+{
+    return _levelOfDetail;
+}
 
-    for (int lineIdx = 0; lineIdx < _linesArcLengthParametrization.size(); ++lineIdx)
-    {
-        QColor dataColor;
-        dataColor.setRgba(_colorMap.rgb(_minData, _maxData, _data[lineIdx]));
-
-        QPen dataPen;
-        dataPen.setColor(dataColor);
-        dataPen.setCapStyle(Qt::RoundCap);
-        //dataPen.setStyle(Qt::SolidLine);
-        dataPen.setWidth(5);
-        painter.setPen(dataPen);
-        painter.drawLine(_linesArcLengthParametrization[lineIdx]);
-    }
+void MainWindow::setLevelOfDetail(const LevelOfDetail levelOfDetail)
+{
+    if (levelOfDetail == _levelOfDetail)
+        return;
 
-    painter.setPen(bluePen);
-    painter.translate(250, 0);
-    painter.drawText(QPoint(15, 20), "Coloring lines demo");
-    
-    for (int lineIdx = 0; lineIdx < _lines.size(); ++lineIdx)
-    {
-        QColor dataColor;
-        dataColor.setRgba(_colorMap.rgb(_minData, _maxData, _data[lineIdx]));
-
-        QPen dataPen;
-        dataPen.setColor(dataColor);
-        dataPen.setCapStyle(Qt::RoundCap);
-        //dataPen.setStyle(Qt::SolidLine);
-        dataPen.setWidth(5);
-        painter.setPen(dataPen);
-        painter.drawLine(_lines[lineIdx]);
-    }
+    _levelOfDetail = levelOfDetail;
+    invalidateLayer(ArcLengthLinesLayer);
+    invalidateLayer(LinesLayer);
 }
 
-double linesLengthBetween2Points(const QPolygonF& pointsSet, const int p1, const int p2)
+double MainWindow::zoom() const
 {
-    const int pointsCount = pointsSet.size();
-    double length = 0.;
+    return _zoom;
+}
 
-    if (p1 < 0 || p1 >= pointsCount || p2 < 0 || p2 >= pointsCount || p1 == p2) {
-        return length;
-    }
+void MainWindow::setZoom(double zoom)
+{
+    if (!(zoom > 0.))
+        return;
 
-    QPointF pointA;
-    QPointF pointB;
+    // unbounded, the wheel would zoom the segments billions of pixels away
+    zoom = qBound(1. / 64., zoom, 1e4);
+    if (zoom == _zoom)
+        return;
 
-    if (p1 < p2) {
-        for (int i = p1; i <= p2 - 1; ++i) {
-            pointA = pointsSet[i];
-            pointB = pointsSet[i + 1];
+    _zoom = zoom;
+    invalidateLayer(ArcLengthLinesLayer);
+    invalidateLayer(LinesLayer);
+}
 
-            length += QLineF(pointA, pointB).length();
-        }
+void MainWindow::setColorMap(const LinearColorMap& colorMap)
+{
+    _colorMap = colorMap;
+    compileColorMap();
+    invalidateLayer(ArcLengthLinesLayer);
+    invalidateLayer(LinesLayer);
+}
+
+void MainWindow::resampleLines()
+{
+    _lines.clear();
+    _linesArcLengthParametrization.clear();
+
+    createNewPointsAndLinesForData(_points, _data.size(), _extendedPoints, _lines);
+    Q_ASSERT(_lines.size() == _data.size());
+
+    lightxbulbCode(_points, _data.size(),
+        _extendedPointsArcLengthParametrization, _linesArcLengthParametrization);
+    Q_ASSERT(_linesArcLengthParametrization.size() == _data.size());
+
+    _linesGrid.build(LineSplitter::SegmentView<QPointF>(pointsSpan(_extendedPoints)));
+    _linesArcLengthGrid.build(LineSplitter::SegmentView<QPointF>(pointsSpan(_extendedPointsArcLengthParametrization)));
+}
+
+void MainWindow::compileColorMap()
+{
+    _compiledColorMap.compile(_colorMap, _minData, _maxData);
+    _palette = _colorMap.colorTable(_minData, _maxData, 256);
+}
+
+void MainWindow::invalidateLayer(const Layer layer)
+{
+    _layers[layer] = QImage();
+    update();
+}
+
+void MainWindow::invalidateLayers()
+{
+    for (int layer = 0; layer < LayerCount; ++layer)
+        _layers[layer] = QImage();
+    update();
+}
+
+// 'R' switches the render mode, 'L' cycles through the level of detail modes
+void MainWindow::keyPressEvent(QKeyEvent* event)
+{
+    if (event->key() == Qt::Key_R)
+    {
+        setRenderMode(_renderMode == RenderMode::Rasterizer ? RenderMode::BucketedLines : RenderMode::Rasterizer);
+        return;
     }
-    else if (p1 > p2) {
-        // or iterate from p1 and when you reach the end iterate from 0 to p2
-        length += QLineF(pointA, pointB).length();
+
+    if (event->key() == Qt::Key_L)
+    {
+        setLevelOfDetail(LevelOfDetail((int(_levelOfDetail) + 1) % (int(LevelOfDetail::Mean) + 1)));
+        return;
     }
 
-    return length;
+    QMainWindow::keyPressEvent(event);
 }
 
-// I think it's better to rewrite this function using the a finite-state machine.
-// NB: inputPoints mustn't contain identical consecutive points
-void createNewPointsAndLinesForData(const QPolygonF& inputPoints, const int dataCount, 
-    QPolygonF& outputPoints, QVector<QLineF>& outputLines)
+// the wheel zooms the colored panels
+void MainWindow::wheelEvent(QWheelEvent* event)
 {
-    outputPoints.clear();
-    outputLines.clear();
+    setZoom(_zoom * std::pow(1.25, event->angleDelta().y() / 120.));
+}
+
+// Level of the data pyramid giving segments of a pixel or more on screen
+// (0: no decimation). The resampled segments all have about the same length.
+size_t MainWindow::levelOfDetailLevel() const
+{
+    if (_levelOfDetail == LevelOfDetail::Off || _data.isEmpty() || _points.size() < 2)
+        return 0;
 
-    if (inputPoints.size() < 2
-        /*|| dataCount < 2 || dataCount < (inputPoints.size() - 1)*/)
+    const double length = LineSplitter::linesLengthBetween2Points(pointsSpan(_points), 0, size_t(_points.size() - 1));
+    const double segmentPixels = length * _zoom / _data.size();
+    return segmentPixels > 0. ? _dataPyramid.levelFor(1. / segmentPixels) : 0;
+}
+
+// 'viewport': visible part of the panel, in panel coordinates
+void MainWindow::drawColoredLines(QPainter& painter, const QPolygonF& points, const QVector<QLineF>& lines,
+    const LineSplitter::SegmentGrid& grid, const QRectF& viewport)
+{
+    const QPolygonF* drawnPoints = &points;
+    const QVector<QLineF>* drawnLines = &lines;
+    const QVector<double>* drawnData = &_data;
+    std::vector<uint32_t> indices; // of the drawn segments, in drawing order
+
+    // sub-pixel segments: pixel-sized segments with the aggregated data instead
+    QPolygonF lodPoints;
+    QVector<QLineF> lodLines;
+    QVector<double> lodData;
+    const size_t level = levelOfDetailLevel();
+    if (level > 0)
     {
-        return;
+        static const LineSplitter::Aggregate aggregates[] = {
+            LineSplitter::Aggregate::Min, LineSplitter::Aggregate::Max, LineSplitter::Aggregate::Mean };
+
+        lodPoints.resize(int(_dataPyramid.size(level)) + 1);
+        lodData.resize(int(_dataPyramid.size(level)));
+        const size_t count = LineSplitter::decimateSegments(pointsSpan(points), _dataPyramid, level,
+            aggregates[int(_levelOfDetail) - 1],
+            LineSplitter::Span<QPointF>(lodPoints.data(), size_t(lodPoints.size())),
+            LineSplitter::Span<double>(lodData.data(), size_t(lodData.size())));
+
+        if (count != 0)
+        {
+            createLines(lodPoints, lodLines);
+            drawnPoints = &lodPoints;
+            drawnLines = &lodLines;
+            drawnData = &lodData;
+            indices.resize(count);
+            std::iota(indices.begin(), indices.end(), 0u);
+        }
     }
 
-    if (dataCount == inputPoints.size() - 1) // + same treatment when dataCount < 2 || dataCount < (inputPoints.size() - 1) ?
+    // full resolution: only the segments crossing the viewport (line width and
+    // antialiasing included)
+    if (drawnPoints == &points)
     {
-        outputPoints = inputPoints;
-        goto createLines;
+        grid.query(viewport.left() / _zoom, viewport.top() / _zoom, viewport.right() / _zoom,
+            viewport.bottom() / _zoom, 3.5 / _zoom, indices);
+        const size_t segmentCount = size_t(std::min(lines.size(), _data.size()));
+        while (!indices.empty() && indices.back() >= segmentCount)
+            indices.pop_back();
     }
 
-    int inputPointsIndexA = 0;
-    int inputPointsIndexB = 1;
-    QPointF pointA(inputPoints[inputPointsIndexA]);
-    QPointF pointB(inputPoints[inputPointsIndexB]);
+    if (_renderMode == RenderMode::BucketedLines)
+    {
+        painter.save();
+        painter.scale(_zoom, _zoom);
+        drawBucketedLines(painter, *drawnLines, *drawnData, indices, _minData, _maxData, _palette, 5);
+        painter.restore();
+    }
+    else
+        painter.drawImage(0, 0, renderColoredSegments(*drawnPoints, *drawnData, indices, _compiledColorMap, size(), 5., _zoom,
+            painter.device()->devicePixelRatioF()));
+}
 
-    outputPoints.push_back(pointA);
+// the panel of the colored segments under the window position 'pos' and the
+// segment under it (SegmentGrid::npos if none)
+size_t MainWindow::segmentAt(const QPointF& pos, Layer& layer) const
+{
+    const Layer layers[] = { LinesLayer, ArcLengthLinesLayer };
+    for (const Layer l : layers)
+    {
+        const LineSplitter::SegmentGrid& grid = l == LinesLayer ? _linesGrid : _linesArcLengthGrid;
+        const QPointF p = (pos - QPointF(panelOffset(l), 0)) / _zoom;
+        const size_t segment = grid.nearest(p.x(), p.y(), 3.5 / _zoom);
+        if (segment != LineSplitter::SegmentGrid::npos && segment < size_t(_data.size()))
+        {
+            layer = l;
+            return segment;
+        }
+    }
+    return LineSplitter::SegmentGrid::npos;
+}
 
-    const int lastInputPointsIndex = inputPoints.size() - 1;
-    const double inputPointsLinesLength = linesLengthBetween2Points(inputPoints, 0, inputPoints.size() - 1);
-    const double step = inputPointsLinesLength / dataCount;
+int MainWindow::panelOffset(const Layer layer)
+{
+    return layer == ArcLengthLinesLayer ? 250 : (layer == LinesLayer ? 500 : 0);
+}
 
-    // if pointA and pointB are the same, we will have funny values in cosine in sine
-    // even better : don't feed this function an inputPoints which can have identical consecutive points
-    double lengthAB = QLineF(pointA, pointB).length();
-    double cosine = (pointB.x() - pointA.x()) / lengthAB;
-    double sine = (pointB.y() - pointA.y()) / lengthAB;
-    double dotProduct = 0.;
+// the data segment under the mouse is shown in the status bar
+void MainWindow::mouseMoveEvent(QMouseEvent* event)
+{
+    Layer layer;
+    const size_t segment = segmentAt(event->localPos(), layer);
+    if (segment == LineSplitter::SegmentGrid::npos)
+        statusBar()->clearMessage();
+    else
+        statusBar()->showMessage(QString("%1: segment %2, data %3")
+                           .arg(layer == LinesLayer ? "Lines" : "Arc length lines")
+                           .arg(segment)
+                           .arg(_data.at(int(segment))));
+
+    QMainWindow::mouseMoveEvent(event);
+}
 
-    QPointF point1(pointA);
-    QPointF point2;
+void MainWindow::paintLayer(const Layer layer, QPainter& painter)
+{
+    QPen pen;
+    pen.setCapStyle(Qt::RoundCap);
+    pen.setWidth(5);
 
-    for (int i = 0; i < dataCount; ++i)
+    switch (layer)
     {
-        point2.setX(point1.x() + cosine * step);
-        point2.setY(point1.y() + sine * step);
+    case OriginalPointsLayer:
+        painter.drawText(QPoint(15, 20), "Original points set + lightxbulb code");
 
-        QVector2D AB(pointB.x() - pointA.x(), pointB.y() - pointA.y());
-        QVector2D BP2(point2.x() - pointB.x(), point2.y() - pointB.y());
-        float dotProduct = QVector2D::dotProduct(BP2, AB); // QVector2D::dotProduct outputs a float
-        if (dotProduct > 0)
+        pen.setColor(Qt::red);
+        painter.setPen(pen);
+        for (const auto& pt : _points)
         {
-            while (dotProduct > 0 && inputPointsIndexB <= lastInputPointsIndex)
-            {
-                double overrun = QLineF(point2, pointB).length();
-
-                if (inputPointsIndexB < lastInputPointsIndex)
-                {
-                    ++inputPointsIndexA; // A becomes B
-                    ++inputPointsIndexB; // B becomes its successor
-                    pointA = inputPoints[inputPointsIndexA];
-                    pointB = inputPoints[inputPointsIndexB];
-                }
-                else
-                {
-                    pointA = inputPoints[lastInputPointsIndex];
-                    pointB = point2; // Hummm....
-
-                    ++inputPointsIndexB; // increment inputPointsIndexB so we can exit the loop
-                }
-
-                lengthAB = QLineF(pointA, pointB).length();
-                
-                // Keep it commented as long as inputPoints doesn't have identical consecutive points
-                /*if (lengthAB == 0.)
-                {
-                    continue;
-                }*/
-
-                cosine = (pointB.x() - pointA.x()) / lengthAB;
-                sine = (pointB.y() - pointA.y()) / lengthAB;
-                point2.setX(pointA.x() + cosine * overrun);
-                point2.setY(pointA.y() + sine * overrun);
-
-                const QVector2D AB{ QPointF { pointB.x() - pointA.x(), pointB.y() - pointA.y() } };
-                const QVector2D BP2{ QPointF { point2.x() - pointB.x(), point2.y() - pointB.y() } };
-                dotProduct = QVector2D::dotProduct(BP2, AB);
-            }
-            if (inputPointsIndexB > lastInputPointsIndex)
-            {
-                // not a good solution :
-                outputPoints.push_back(inputPoints.back());
-
-                // there will be missing points in some cases... why ?
-
-                break; // no more input points, break the for loop
-            }
-            
-            outputPoints.push_back(point2);
-
-            // what if dotProduct is equal to zero ? we need to update 'cosine' and 'sine' values
-            if (dotProduct == 0. && inputPointsIndexB < lastInputPointsIndex)
-            {
-                // This is correct as long as inputPoints doesn't have identical consecutive points
-                ++inputPointsIndexA;
-                ++inputPointsIndexB;
-                pointA = inputPoints[inputPointsIndexA];
-                pointB = inputPoints[inputPointsIndexB];
-                lengthAB = QLineF(pointA, pointB).length();
-                cosine = (pointB.x() - pointA.x()) / lengthAB;
-                sine = (pointB.y() - pointA.y()) / lengthAB;
-            }
+            painter.drawPoint(pt);
         }
-        else
+
+        pen.setColor(Qt::black);
+        painter.setPen(pen);
+        for (const auto& pt : _extendedPointsArcLengthParametrization)
         {
-            outputPoints.push_back(point2);
+            painter.drawPoint(pt);
         }
+        break;
+
+    case ExtendedPointsLayer:
+        pen.setColor(Qt::darkGreen);
+        painter.setPen(pen);
+        painter.drawText(QPoint(15, 20), "Extended points set");
+        for (const auto& pt : _extendedPoints)
+        {
+            painter.drawPoint(pt);
+        }
+        break;
+
+    case ArcLengthLinesLayer:
+        pen.setColor(Qt::blue);
+        painter.setPen(pen);
+        painter.translate(panelOffset(layer), 0);
+        painter.drawText(QPoint(15, 20), "Coloring lines demo (lightxbulb)");
+
+        drawColoredLines(painter, _extendedPointsArcLengthParametrization, _linesArcLengthParametrization,
+            _linesArcLengthGrid, QRectF(-panelOffset(layer), 0, width(), height()));
+        break;
+
+    case LinesLayer:
+        pen.setColor(Qt::blue);
+        painter.setPen(pen);
+        painter.translate(panelOffset(layer), 0);
+        painter.drawText(QPoint(15, 20), "Coloring lines demo");
 
-        point1 = point2;
+        drawColoredLines(painter, _extendedPoints, _lines, _linesGrid, QRectF(-panelOffset(layer), 0, width(), height()));
+        break;
+
+    case LayerCount:
+        break;
     }
+}
+
+// Repainting only blits the cached layers: a layer is redrawn when the
+// data, the points, the color map, the render mode, the window size or the
+// device pixel ratio change.
+void MainWindow::paintEvent(QPaintEvent* event)
+{
+    QPainter painter(this);
 
-createLines:
-    for (int i = 0; i < outputPoints.size() - 1; i++)
+    // the layers are cached in device pixels, so they stay sharp on high DPI screens
+    const qreal ratio = devicePixelRatioF();
+    const QSize pixelSize = size() * ratio;
+    const QRect source(event->rect().topLeft() * ratio, event->rect().size() * ratio);
+    for (int layer = 0; layer < LayerCount; ++layer)
     {
-        outputLines.push_back(QLineF(outputPoints[i], outputPoints[i + 1]));
+        QImage& image = _layers[layer];
+        if (image.size() != pixelSize || image.devicePixelRatio() != ratio)
+        {
+            image = QImage(pixelSize, QImage::Format_ARGB32_Premultiplied);
+            image.setDevicePixelRatio(ratio);
+            image.fill(Qt::transparent);
+
+            QPainter layerPainter(&image);
+            layerPainter.setRenderHint(QPainter::Antialiasing, true);
+            paintLayer(Layer(layer), layerPainter);
+        }
+
+        painter.drawImage(event->rect(), image, source);
     }
 }
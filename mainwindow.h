@@ -1,14 +1,18 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include <QImage>
 #include <QLineF>
 #include <QMainWindow>
 #include <QPolygonF>
 
 #include "colorMapPresets.h"
+#include "dataPyramid.h"
+#include "segmentGrid.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
+class QPainter;
 QT_END_NAMESPACE
 
 class MainWindow : public QMainWindow
@@ -16,13 +20,68 @@ class MainWindow : public QMainWindow
     Q_OBJECT
 
 public:
+    // how the colored segments are drawn
+    enum class RenderMode
+    {
+        Rasterizer,   // rasterized into an image (see segmentRasterizer.h)
+        BucketedLines // one drawLines() per color of a palette
+    };
+
+    // data of the sub-pixel segments aggregated into pixel-sized segments
+    enum class LevelOfDetail
+    {
+        Off,
+        Min,
+        Max,
+        Mean
+    };
+
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+    RenderMode renderMode() const;
+    void setRenderMode(RenderMode mode);
+
+    void setPoints(const QPolygonF& points);
+    void setData(const QVector<double>& data);
+    void setColorMap(const LinearColorMap& colorMap);
+
+    LevelOfDetail levelOfDetail() const;
+    void setLevelOfDetail(LevelOfDetail levelOfDetail);
+
+    // scale of the colored panels, clamped to [1/64, 1e4]
+    double zoom() const;
+    void setZoom(double zoom);
+
     void paintEvent(QPaintEvent* event) override;
+    void keyPressEvent(QKeyEvent* event) override;
+    void wheelEvent(QWheelEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
 
 
 private:
+    // panels of the window, each one cached in an image of the widget size
+    enum Layer
+    {
+        OriginalPointsLayer,
+        ExtendedPointsLayer,
+        ArcLengthLinesLayer,
+        LinesLayer,
+        LayerCount
+    };
+
+    void resampleLines();
+    void compileColorMap();
+    void invalidateLayer(Layer layer);
+    void invalidateLayers();
+    size_t levelOfDetailLevel() const;
+
+    void paintLayer(Layer layer, QPainter& painter);
+    static int panelOffset(Layer layer);
+    size_t segmentAt(const QPointF& pos, Layer& layer) const;
+    void drawColoredLines(QPainter& painter, const QPolygonF& points, const QVector<QLineF>& lines,
+        const LineSplitter::SegmentGrid& grid, const QRectF& viewport);
+
     Ui::MainWindow* _ui;
 
     QVector<double> _data;
@@ -36,6 +95,23 @@ private:
     QPolygonF _extendedPointsArcLengthParametrization;
     QVector<QLineF> _linesArcLengthParametrization;
 
+    // spatial indexes of _lines and _linesArcLengthParametrization (culling, hit tests)
+    LineSplitter::SegmentGrid _linesGrid;
+    LineSplitter::SegmentGrid _linesArcLengthGrid;
+
     LinearColorMap _colorMap;
+    CompiledColorMap _compiledColorMap;
+
+    RenderMode _renderMode;
+    QVector<QRgb> _palette; // colors of the BucketedLines mode
+
+    // over _data.constData(): _data is shared with the caller of setData(),
+    // read it with const accessors only (a detach would move it)
+    LineSplitter::DataPyramid _dataPyramid;
+    LevelOfDetail _levelOfDetail;
+    double _zoom;
+
+    // a null or wrongly sized layer is repainted by the next paintEvent()
+    QImage _layers[LayerCount];
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "lineSplitter.h"
+
+#include <cstdint>
+#include <new>
+
+namespace LineSplitter
+{
+
+/* Bump allocator over a caller-owned buffer: allocations just move a cursor
+ * and are all released at once by reset() (e.g. once per frame). It never
+ * falls back to the heap: allocate() returns an empty span when the buffer is
+ * full.
+ */
+class MonotonicArena
+{
+public:
+    MonotonicArena(void* buffer, const size_t capacity) :
+        _buffer(static_cast<unsigned char*>(buffer)),
+        _capacity(capacity),
+        _used(0)
+    {
+    }
+
+    /* Bytes to reserve for an allocation of 'count' T, alignment padding included. */
+    template <typename T>
+    static size_t bytesFor(const size_t count)
+    {
+        return count * sizeof(T) + alignof(T) - 1;
+    }
+
+    template <typename T>
+    Span<T> allocate(const size_t count)
+    {
+        const uintptr_t address = reinterpret_cast<uintptr_t>(_buffer + _used);
+        const size_t padding = (alignof(T) - address % alignof(T)) % alignof(T);
+        if (padding + count * sizeof(T) > _capacity - _used)
+            return Span<T>();
+
+        T* data = reinterpret_cast<T*>(_buffer + _used + padding);
+        for (size_t i = 0; i < count; ++i)
+            new (data + i) T;
+        _used += padding + count * sizeof(T);
+        return Span<T>(data, count);
+    }
+
+    /* Releases everything allocated after mark() was called. */
+    size_t mark() const { return _used; }
+    void rewind(const size_t mark) { _used = mark < _used ? mark : _used; }
+    void reset() { _used = 0; }
+
+    size_t used() const { return _used; }
+    size_t capacity() const { return _capacity; }
+
+private:
+    unsigned char* _buffer;
+    size_t _capacity;
+    size_t _used;
+};
+
+/* Arena bytes needed by the arena overload of resampleArcLength(),
+ * scratch (released before returning) included. */
+template <typename P, typename Precision = FloatPrecision>
+size_t arenaBytesForResampling(const size_t inputCount, const int dataCount)
+{
+    return MonotonicArena::bytesFor<P>(outputPointsCount(dataCount))
+        + MonotonicArena::bytesFor<typename Precision::Real>(inputCount);
+}
+
+/* Arena bytes needed by the arena overload of makeSegments(). */
+template <typename P>
+size_t arenaBytesForSegments(const size_t pointsCount)
+{
+    return pointsCount < 2 ? 0 : MonotonicArena::bytesFor<Segment<P> >(pointsCount - 1);
+}
+
+/* resampleArcLength() with the output points and the scratch distances taken
+ * from 'arena': no heap allocation. The scratch is released before returning,
+ * the output points stay allocated until the arena is reset.
+ *
+ * Returns an empty span if the input is invalid or the arena too small.
+ * P can't be deduced from the arguments: call resampleArcLength<P>(...).
+ */
+template <typename P, typename Precision = FloatPrecision>
+Span<P> resampleArcLength(Span<const typename NonDeduced<P>::type> input, const int dataCount, MonotonicArena& arena)
+{
+    const size_t start = arena.mark();
+    const Span<P> output = arena.allocate<P>(outputPointsCount(dataCount));
+
+    const size_t scratchStart = arena.mark();
+    const Span<typename Precision::Real> dists = arena.allocate<typename Precision::Real>(input.size);
+
+    const size_t count = (output.empty() || dists.empty())
+        ? 0 : resampleArcLength<P, Precision>(input, dataCount, output, dists);
+    if (count == 0)
+    {
+        arena.rewind(start);
+        return Span<P>();
+    }
+
+    arena.rewind(scratchStart);
+    return output;
+}
+
+/* makeSegments() with the segments taken from 'arena' (call makeSegments<P>). */
+template <typename P>
+Span<Segment<P> > makeSegments(Span<const typename NonDeduced<P>::type> points, MonotonicArena& arena)
+{
+    if (points.size < 2)
+        return Span<Segment<P> >();
+
+    const Span<Segment<P> > segments = arena.allocate<Segment<P> >(points.size - 1);
+    if (!segments.empty())
+        makeSegments<P>(points, segments);
+    return segments;
+}
+
+}
@@ -0,0 +1,79 @@
+#include "allocationCounter.h"
+#include "monotonicArena.h"
+
+#include <cstdio>
+#include <vector>
+
+/* Checks that the arena overloads of resampleArcLength() and makeSegments()
+ * never allocate on the heap (every operator new is counted), across repeated
+ * calls with the arena reset in between, and that they output the same
+ * points as the heap versions. Returns non-zero on failure.
+ */
+
+namespace
+{
+
+typedef LineSplitter::Point2<double> Point;
+
+}
+
+int main()
+{
+    int failures = 0;
+
+    std::vector<Point> input(1000);
+    for (size_t i = 0; i < input.size(); ++i)
+    {
+        input[i].x = double(i % 17) * 3.;
+        input[i].y = double(i) * 0.5;
+    }
+
+    const int dataCounts[] = { 1, 10, 999, 5000 };
+    std::vector<std::vector<Point> > expected;
+    size_t arenaBytes = 0;
+    for (const int dataCount : dataCounts)
+    {
+        expected.push_back(std::vector<Point>(LineSplitter::outputPointsCount(dataCount)));
+        LineSplitter::resampleArcLength<Point>(LineSplitter::makeSpan(input), dataCount,
+            LineSplitter::makeSpan(expected.back()));
+        const size_t bytes = LineSplitter::arenaBytesForResampling<Point>(input.size(), dataCount)
+            + LineSplitter::arenaBytesForSegments<Point>(expected.back().size());
+        arenaBytes = bytes > arenaBytes ? bytes : arenaBytes;
+    }
+    std::vector<unsigned char> buffer(arenaBytes);
+    LineSplitter::MonotonicArena arena(buffer.data(), buffer.size());
+
+    // a non-const span: the input must not take part in the deduction of P
+    const LineSplitter::Span<Point> inputSpan = LineSplitter::makeSpan(input);
+
+    const size_t allocationsBefore = g_allocations;
+    for (int frame = 0; frame < 100; ++frame)
+    {
+        for (size_t k = 0; k < expected.size(); ++k)
+        {
+            arena.reset();
+            const LineSplitter::Span<Point> points = LineSplitter::resampleArcLength<Point>(inputSpan, dataCounts[k], arena);
+            const LineSplitter::Span<LineSplitter::Segment<Point> > segments = LineSplitter::makeSegments<Point>(points, arena);
+            if (points.size != expected[k].size() || segments.size + 1 != points.size)
+            {
+                ++failures;
+                continue;
+            }
+            for (size_t i = 0; i < points.size; ++i)
+                if (points[i].x != expected[k][i].x || points[i].y != expected[k][i].y)
+                {
+                    ++failures;
+                    break;
+                }
+        }
+    }
+    const size_t allocations = g_allocations - allocationsBefore;
+
+    if (allocations != 0)
+    {
+        std::fprintf(stderr, "FAIL %zu heap allocations in the arena path\n", allocations);
+        ++failures;
+    }
+    std::printf("arena path: %zu heap allocation(s), %d failure(s)\n", allocations, failures);
+    return failures == 0 ? 0 : 1;
+}
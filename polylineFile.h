@@ -0,0 +1,454 @@
+#pragma once
+
+#include "lineSplitter.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
+#include <vector>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* Binary polyline file, read and written through memory mappings: the
+ * sections are used in place as the spans of the batch resamplers (see
+ * lineSplitterBatch.h), nothing is parsed or copied.
+ *
+ * Layout (native byte order, every section aligned on 64 bytes):
+ *   header        PolylineFileHeader
+ *   vertices      Point2<double>[vertexCount]
+ *   offsets       uint64[polylineCount + 1]  polyline k = vertices [offsets[k], offsets[k + 1])
+ *   valueOffsets  uint64[polylineCount + 1]  values of polyline k = values [valueOffsets[k], valueOffsets[k + 1])
+ *   values        double[valueCount]
+ *   colors        uint32[valueCount]         optional (HasColors), #AARRGGBB as QRgb
+ *
+ * An input file holds the polylines and their data. An output file of the
+ * resampler holds the resampled points of each polyline (one more than its
+ * values, none if it couldn't be resampled), the same values and the color of
+ * every segment.
+ */
+namespace LineSplitter
+{
+
+// the offsets sections are mapped as size_t, the type of the batch offsets
+static_assert(sizeof(size_t) == sizeof(uint64_t), "polyline files need a 64-bit size_t");
+
+struct PolylineFileHeader
+{
+    enum Flags
+    {
+        HasColors = 1
+    };
+
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t polylineCount;
+    uint64_t vertexCount;
+    uint64_t valueCount;
+
+    // in bytes from the beginning of the file
+    uint64_t verticesOffset;
+    uint64_t offsetsOffset;
+    uint64_t valueOffsetsOffset;
+    uint64_t valuesOffset;
+    uint64_t colorsOffset; // 0 without colors
+    uint64_t fileSize;
+
+    static const uint32_t CurrentVersion = 1;
+
+    static const char* magicString() { return "LSPOLY\r\n"; }
+
+    /* Header of a file of these sizes, the sections laid out one after the other. */
+    static PolylineFileHeader make(const size_t polylineCount, const size_t vertexCount, const size_t valueCount,
+        const bool hasColors)
+    {
+        PolylineFileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, magicString(), sizeof(header.magic));
+        header.version = CurrentVersion;
+        header.flags = hasColors ? HasColors : 0;
+        header.polylineCount = polylineCount;
+        header.vertexCount = vertexCount;
+        header.valueCount = valueCount;
+
+        uint64_t offset = align(sizeof(PolylineFileHeader));
+        header.verticesOffset = offset;
+        offset = align(offset + vertexCount * sizeof(Point2<double>));
+        header.offsetsOffset = offset;
+        offset = align(offset + (polylineCount + 1) * sizeof(uint64_t));
+        header.valueOffsetsOffset = offset;
+        offset = align(offset + (polylineCount + 1) * sizeof(uint64_t));
+        header.valuesOffset = offset;
+        offset = align(offset + valueCount * sizeof(double));
+        if (hasColors)
+        {
+            header.colorsOffset = offset;
+            offset = align(offset + valueCount * sizeof(uint32_t));
+        }
+        header.fileSize = offset;
+        return header;
+    }
+
+    bool hasColors() const { return (flags & HasColors) != 0; }
+
+private:
+    static uint64_t align(const uint64_t offset) { return (offset + 63) & ~uint64_t(63); }
+};
+
+namespace detail
+{
+
+/* Read-only or read-write mapping of a whole file (a plain buffer, read at
+ * open and written at close, where mmap isn't available). */
+class FileMapping
+{
+public:
+    FileMapping() {}
+    ~FileMapping() { close(); }
+
+    FileMapping(const FileMapping&) = delete;
+    FileMapping& operator=(const FileMapping&) = delete;
+
+    bool openReadOnly(const char* path, std::string& error)
+    {
+        close();
+#ifdef _WIN32
+        FILE* file = std::fopen(path, "rb");
+        if (!file)
+            return fail("cannot open", path, error);
+        std::fseek(file, 0, SEEK_END);
+        _buffer.resize(size_t(std::ftell(file)));
+        std::fseek(file, 0, SEEK_SET);
+        const bool ok = std::fread(_buffer.data(), 1, _buffer.size(), file) == _buffer.size();
+        std::fclose(file);
+        if (!ok)
+            return fail("cannot read", path, error);
+        _data = _buffer.data();
+        _size = _buffer.size();
+#else
+        _fd = ::open(path, O_RDONLY);
+        if (_fd < 0)
+            return fail("cannot open", path, error);
+        struct stat status;
+        if (::fstat(_fd, &status) != 0)
+            return fail("cannot stat", path, error);
+        _size = size_t(status.st_size);
+        if (_size != 0)
+        {
+            void* data = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, _fd, 0);
+            if (data == MAP_FAILED)
+                return fail("cannot map", path, error);
+            _data = static_cast<unsigned char*>(data);
+            ::madvise(data, _size, MADV_SEQUENTIAL);
+        }
+#endif
+        return true;
+    }
+
+    /* Creates (or truncates) the file with 'size' zero bytes. */
+    bool create(const char* path, const size_t size, std::string& error)
+    {
+        close();
+        _path = path;
+        _writable = true;
+        _size = size;
+#ifdef _WIN32
+        _buffer.assign(size, 0);
+        _data = _buffer.data();
+#else
+        _fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (_fd < 0)
+            return fail("cannot create", path, error);
+        if (::ftruncate(_fd, off_t(size)) != 0)
+            return fail("cannot resize", path, error);
+        void* data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+        if (data == MAP_FAILED)
+            return fail("cannot map", path, error);
+        _data = static_cast<unsigned char*>(data);
+#endif
+        return true;
+    }
+
+    /* Unmaps the file. False if a writable mapping couldn't be written. */
+    bool close()
+    {
+        bool ok = true;
+#ifdef _WIN32
+        if (_writable && _data)
+        {
+            FILE* file = std::fopen(_path.c_str(), "wb");
+            ok = file && std::fwrite(_buffer.data(), 1, _buffer.size(), file) == _buffer.size();
+            if (file)
+                ok = std::fclose(file) == 0 && ok;
+        }
+        _buffer.clear();
+#else
+        if (_data)
+            ok = ::munmap(_data, _size) == 0;
+        if (_fd >= 0)
+            ok = ::close(_fd) == 0 && ok;
+        _fd = -1;
+#endif
+        _data = nullptr;
+        _size = 0;
+        _writable = false;
+        return ok;
+    }
+
+    unsigned char* data() const { return _data; }
+    size_t size() const { return _size; }
+
+    /* Streaming over a mapping larger than the memory: prefetch() starts
+     * reading the pages of [data, data + bytes) in the background, release()
+     * writes them back if they are dirty and drops them from the process.
+     * Pages are only unmapped (their content stays in the page cache), so the
+     * pages shared with neighbouring ranges still in use can be released. */
+    void prefetch(const void* data, const size_t bytes) const
+    {
+#ifndef _WIN32
+        size_t length;
+        if (void* page = pages(data, bytes, length))
+            ::madvise(page, length, MADV_WILLNEED);
+#else
+        (void)data;
+        (void)bytes;
+#endif
+    }
+
+    bool release(const void* data, const size_t bytes) const
+    {
+#ifndef _WIN32
+        size_t length;
+        if (void* page = pages(data, bytes, length))
+        {
+            const bool ok = !_writable || ::msync(page, length, MS_SYNC) == 0;
+            ::madvise(page, length, MADV_DONTNEED);
+            return ok;
+        }
+#else
+        (void)data;
+        (void)bytes;
+#endif
+        return true;
+    }
+
+private:
+#ifndef _WIN32
+    // whole pages of the mapping covering [data, data + bytes)
+    void* pages(const void* data, const size_t bytes, size_t& length) const
+    {
+        if (!_data || bytes == 0)
+            return nullptr;
+        const size_t pageSize = size_t(::sysconf(_SC_PAGESIZE));
+        const size_t begin = size_t(static_cast<const unsigned char*>(data) - _data) / pageSize * pageSize;
+        const size_t end = std::min(_size, size_t(static_cast<const unsigned char*>(data) - _data) + bytes);
+        length = end - begin;
+        return _data + begin;
+    }
+#endif
+
+    bool fail(const char* what, const char* path, std::string& error)
+    {
+        error = std::string(what) + " '" + path + "'";
+        close();
+        return false;
+    }
+
+    unsigned char* _data = nullptr;
+    size_t _size = 0;
+    bool _writable = false;
+    std::string _path;
+#ifdef _WIN32
+    std::vector<unsigned char> _buffer;
+#else
+    int _fd = -1;
+#endif
+};
+
+}
+
+/* Read-only view of a polyline file: the spans point into the mapping and
+ * are valid until close() or the destruction of the file.
+ *
+ * open() checks the header and that the offsets are consistent (sorted,
+ * within the sections), so the spans can be given as is to the resamplers.
+ */
+class PolylineFileReader
+{
+public:
+    typedef Point2<double> Point;
+
+    bool open(const char* path)
+    {
+        if (!_mapping.openReadOnly(path, _error))
+            return false;
+
+        if (_mapping.size() < sizeof(PolylineFileHeader))
+            return fail("not a polyline file (too small)");
+        std::memcpy(&_header, _mapping.data(), sizeof(_header));
+        if (std::memcmp(_header.magic, PolylineFileHeader::magicString(), sizeof(_header.magic)) != 0)
+            return fail("not a polyline file");
+        if (_header.version != PolylineFileHeader::CurrentVersion)
+            return fail("unsupported polyline file version");
+
+        // the sections must be where make() puts them (and the counts small
+        // enough not to overflow the offsets)
+        if (_header.polylineCount >= _mapping.size() / sizeof(uint64_t)
+            || _header.vertexCount > _mapping.size() / sizeof(Point)
+            || _header.valueCount > _mapping.size() / sizeof(double))
+            return fail("corrupted polyline file header");
+        const PolylineFileHeader expected = PolylineFileHeader::make(size_t(_header.polylineCount),
+            size_t(_header.vertexCount), size_t(_header.valueCount), _header.hasColors());
+        if (std::memcmp(&expected, &_header, sizeof(_header)) != 0 || _header.fileSize > _mapping.size())
+            return fail("corrupted polyline file header");
+
+        const Span<const size_t> vertexOffsets = offsets();
+        const Span<const size_t> valueOffsets = this->valueOffsets();
+        if (vertexOffsets[0] != 0 || valueOffsets[0] != 0
+            || vertexOffsets[polylineCount()] != _header.vertexCount
+            || valueOffsets[polylineCount()] != _header.valueCount)
+            return fail("corrupted polyline file offsets");
+        for (size_t k = 0; k < polylineCount(); ++k)
+        {
+            if (vertexOffsets[k + 1] < vertexOffsets[k] || valueOffsets[k + 1] < valueOffsets[k]
+                || valueOffsets[k + 1] - valueOffsets[k] > size_t(INT32_MAX) - 1)
+                return fail("corrupted polyline file offsets");
+        }
+        return true;
+    }
+
+    void close() { _mapping.close(); }
+
+    const std::string& errorString() const { return _error; }
+    const PolylineFileHeader& header() const { return _header; }
+
+    size_t polylineCount() const { return size_t(_header.polylineCount); }
+    bool hasColors() const { return _header.hasColors(); }
+
+    /* Streaming hints for a part of a section, see detail::FileMapping. */
+    template <typename T>
+    void prefetch(const Span<T>& part) const { _mapping.prefetch(part.data, part.size * sizeof(T)); }
+    template <typename T>
+    void release(const Span<T>& part) const { _mapping.release(part.data, part.size * sizeof(T)); }
+
+    Span<const Point> vertices() const
+    {
+        return section<const Point>(_header.verticesOffset, size_t(_header.vertexCount));
+    }
+    Span<const size_t> offsets() const
+    {
+        return section<const size_t>(_header.offsetsOffset, polylineCount() + 1);
+    }
+    Span<const size_t> valueOffsets() const
+    {
+        return section<const size_t>(_header.valueOffsetsOffset, polylineCount() + 1);
+    }
+    Span<const double> values() const
+    {
+        return section<const double>(_header.valuesOffset, size_t(_header.valueCount));
+    }
+    Span<const uint32_t> colors() const
+    {
+        return hasColors() ? section<const uint32_t>(_header.colorsOffset, size_t(_header.valueCount))
+                           : Span<const uint32_t>();
+    }
+
+    Span<const Point> polyline(const size_t k) const
+    {
+        return Span<const Point>(vertices().data + offsets()[k], offsets()[k + 1] - offsets()[k]);
+    }
+    Span<const double> polylineValues(const size_t k) const
+    {
+        return Span<const double>(values().data + valueOffsets()[k], valueOffsets()[k + 1] - valueOffsets()[k]);
+    }
+
+private:
+    template <typename T>
+    Span<T> section(const uint64_t offset, const size_t count) const
+    {
+        return Span<T>(reinterpret_cast<T*>(_mapping.data() + offset), count);
+    }
+
+    bool fail(const char* what)
+    {
+        _error = what;
+        _mapping.close();
+        return false;
+    }
+
+    detail::FileMapping _mapping;
+    PolylineFileHeader _header;
+    std::string _error;
+};
+
+/* Writable polyline file of known sizes: create() sizes and maps it, the
+ * sections are then filled in place (e.g. by the resamplers) and close()
+ * writes it. The offsets must be filled by the caller.
+ */
+class PolylineFileWriter
+{
+public:
+    typedef Point2<double> Point;
+
+    bool create(const char* path, const size_t polylineCount, const size_t vertexCount, const size_t valueCount,
+        const bool hasColors)
+    {
+        _header = PolylineFileHeader::make(polylineCount, vertexCount, valueCount, hasColors);
+        if (!_mapping.create(path, size_t(_header.fileSize), _error))
+            return false;
+        std::memcpy(_mapping.data(), &_header, sizeof(_header));
+        return true;
+    }
+
+    /* False if the file couldn't be written. */
+    bool close()
+    {
+        if (!_mapping.close())
+        {
+            _error = "cannot write the polyline file";
+            return false;
+        }
+        return true;
+    }
+
+    const std::string& errorString() const { return _error; }
+    const PolylineFileHeader& header() const { return _header; }
+
+    size_t polylineCount() const { return size_t(_header.polylineCount); }
+
+    /* Writes a part of a section to the file and drops it from the process
+     * memory (it can still be written again). False on a write error. */
+    template <typename T>
+    bool flush(const Span<T>& part) const { return _mapping.release(part.data, part.size * sizeof(T)); }
+
+    Span<Point> vertices() const { return section<Point>(_header.verticesOffset, size_t(_header.vertexCount)); }
+    Span<size_t> offsets() const { return section<size_t>(_header.offsetsOffset, polylineCount() + 1); }
+    Span<size_t> valueOffsets() const { return section<size_t>(_header.valueOffsetsOffset, polylineCount() + 1); }
+    Span<double> values() const { return section<double>(_header.valuesOffset, size_t(_header.valueCount)); }
+    Span<uint32_t> colors() const
+    {
+        return _header.hasColors() ? section<uint32_t>(_header.colorsOffset, size_t(_header.valueCount))
+                                   : Span<uint32_t>();
+    }
+
+private:
+    template <typename T>
+    Span<T> section(const uint64_t offset, const size_t count) const
+    {
+        return Span<T>(reinterpret_cast<T*>(_mapping.data() + offset), count);
+    }
+
+    detail::FileMapping _mapping;
+    PolylineFileHeader _header;
+    std::string _error;
+};
+
+}
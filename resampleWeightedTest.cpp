@@ -0,0 +1,180 @@
+#include "lineSplitter.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+/* Checks resampleWeighted() against a brute-force walk along the polyline in
+ * double precision, with zero weights (at both ends too) and repeated
+ * vertices; with uniform weights it must give the points of
+ * resampleArcLength(). Negative, NaN, infinite and all-zero weights must be
+ * rejected without writing the output. Returns non-zero on failure.
+ */
+
+namespace
+{
+
+typedef LineSplitter::Point2<double> Point;
+
+int g_failures = 0;
+
+double lengthOf(const std::vector<Point>& polyline)
+{
+    double length = 0.;
+    for (size_t j = 1; j < polyline.size(); ++j)
+        length += LineSplitter::distance(polyline[j - 1], polyline[j]);
+    return length;
+}
+
+// point at the distance s along the polyline, walking the segments one by one
+Point pointAt(const std::vector<Point>& polyline, double s)
+{
+    for (size_t j = 1; j < polyline.size(); ++j)
+    {
+        const Point& a = polyline[j - 1];
+        const Point& b = polyline[j];
+        const double length = LineSplitter::distance(a, b);
+        if (s <= length)
+        {
+            const double t = length > 0. ? s / length : 0.;
+            return Point{ a.x + t * (b.x - a.x), a.y + t * (b.y - a.y) };
+        }
+        s -= length;
+    }
+    return polyline.back();
+}
+
+// random walk, every 'repeat'-th vertex repeated if 'repeat' > 0 (the first and the last ones too)
+std::vector<Point> makePolyline(std::mt19937& rng, const size_t count, const size_t repeat)
+{
+    std::uniform_real_distribution<double> step(-10., 10.);
+    std::vector<Point> polyline(1, Point{ 0., 0. });
+    if (repeat > 0)
+        polyline.push_back(polyline.back());
+    for (size_t j = 1; j < count; ++j)
+    {
+        polyline.push_back(Point{ polyline.back().x + step(rng), polyline.back().y + step(rng) });
+        if (repeat > 0 && (j % repeat == 0 || j + 1 == count))
+            polyline.push_back(polyline.back());
+    }
+    return polyline;
+}
+
+template <typename Precision>
+void checkWeighted(const char* name, const std::vector<Point>& polyline, const std::vector<double>& weights,
+    const double tolerance)
+{
+    std::vector<Point> output(weights.size() + 1);
+    const size_t count = LineSplitter::resampleWeighted<Point, Precision>(LineSplitter::makeSpan(polyline),
+        LineSplitter::makeSpan(weights), LineSplitter::makeSpan(output));
+    if (count != output.size())
+    {
+        std::fprintf(stderr, "FAIL %s: %zu points instead of %zu\n", name, count, output.size());
+        ++g_failures;
+        return;
+    }
+
+    double total = 0.;
+    for (const double weight : weights)
+        total += weight;
+    const double length = lengthOf(polyline);
+
+    double error = 0.;
+    double weight = 0.;
+    bool zeroWeightsCollapse = true;
+    for (size_t i = 0; i < output.size(); ++i)
+    {
+        const Point expected = pointAt(polyline, length * weight / total);
+        const double e = std::hypot(output[i].x - expected.x, output[i].y - expected.y);
+        error = std::isnan(e) ? HUGE_VAL : std::max(error, e);
+        if (i < weights.size())
+        {
+            // a zero weight gives a zero-length output segment
+            if (weights[i] == 0. && i + 1 < weights.size())
+                zeroWeightsCollapse = zeroWeightsCollapse && output[i].x == output[i + 1].x
+                    && output[i].y == output[i + 1].y;
+            weight += weights[i];
+        }
+    }
+    const bool ends = std::memcmp(&output.front(), &polyline.front(), sizeof(Point)) == 0
+        && std::memcmp(&output.back(), &polyline.back(), sizeof(Point)) == 0;
+
+    if (!(error <= tolerance * length) || !zeroWeightsCollapse || !ends)
+    {
+        std::fprintf(stderr, "FAIL %s, %zu vertices, %zu weights: error %g (length %g)%s%s\n", name, polyline.size(),
+            weights.size(), error, length, zeroWeightsCollapse ? "" : ", zero weight with a non-zero length",
+            ends ? "" : ", ends moved");
+        ++g_failures;
+    }
+}
+
+void checkRejected(const char* name, const std::vector<Point>& polyline, const std::vector<double>& weights)
+{
+    const Point sentinel = { -1234.5, 6789.25 };
+    std::vector<Point> output(weights.size() + 1, sentinel);
+    const size_t count = LineSplitter::resampleWeighted<Point>(LineSplitter::makeSpan(polyline),
+        LineSplitter::makeSpan(weights), LineSplitter::makeSpan(output));
+    bool untouched = true;
+    for (const Point& p : output)
+        untouched = untouched && std::memcmp(&p, &sentinel, sizeof(Point)) == 0;
+
+    if (count != 0 || !untouched)
+    {
+        std::fprintf(stderr, "FAIL %s: %zu points written instead of 0%s\n", name, count,
+            untouched ? "" : ", output modified");
+        ++g_failures;
+    }
+}
+
+}
+
+int main()
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> random(0., 3.);
+    for (const size_t vertices : { 2, 3, 10, 1000 })
+        for (const size_t repeat : { 0, 1, 4 })
+        {
+            const std::vector<Point> polyline = makePolyline(rng, vertices, repeat);
+            for (const size_t weightCount : { 1, 2, 7, 1000 })
+            {
+                // random weights, every 3rd one zero, the first and the last ones included
+                std::vector<double> weights(weightCount);
+                for (size_t i = 0; i < weightCount; ++i)
+                    weights[i] = i % 3 == 0 || i + 1 == weightCount ? 0. : random(rng);
+                weights[weightCount / 2] = 1.; // not all zero
+                checkWeighted<LineSplitter::DoublePrecision>("double", polyline, weights, 1e-12);
+                checkWeighted<LineSplitter::FloatPrecision>("float", polyline, weights, 1e-5);
+
+                // uniform weights: the points of resampleArcLength()
+                const std::vector<double> uniform(weightCount, 2.5);
+                std::vector<Point> weighted(weightCount + 1), arcLength(weightCount + 1);
+                LineSplitter::resampleWeighted<Point, LineSplitter::DoublePrecision>(LineSplitter::makeSpan(polyline),
+                    LineSplitter::makeSpan(uniform), LineSplitter::makeSpan(weighted));
+                LineSplitter::resampleArcLength<Point, LineSplitter::DoublePrecision>(
+                    LineSplitter::makeSpan(polyline), int(weightCount), LineSplitter::makeSpan(arcLength));
+                const double length = lengthOf(polyline);
+                for (size_t i = 0; i < weighted.size(); ++i)
+                    if (std::hypot(weighted[i].x - arcLength[i].x, weighted[i].y - arcLength[i].y) > 1e-12 * length)
+                    {
+                        std::fprintf(stderr, "FAIL uniform weights, %zu vertices, %zu weights: point %zu differs "
+                            "from resampleArcLength()\n", polyline.size(), weightCount, i);
+                        ++g_failures;
+                        break;
+                    }
+            }
+        }
+
+    const std::vector<Point> polyline = makePolyline(rng, 10, 0);
+    checkRejected("negative weight", polyline, { 1., -0.5, 2. });
+    checkRejected("NaN weight", polyline, { 1., std::nan(""), 2. });
+    checkRejected("infinite weight", polyline, { 1., HUGE_VAL, 2. });
+    checkRejected("all-zero weights", polyline, { 0., 0., 0. });
+    checkRejected("no weight", polyline, {});
+    checkRejected("single vertex", std::vector<Point>(1, Point{ 1., 2. }), { 1., 2. });
+
+    std::printf("%d failure(s)\n", g_failures);
+    return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "lineSplitter.h"
+
+#include <cmath>
+
+namespace LineSplitter
+{
+
+/* Closed polylines (rings: isolines, building footprints...): the points are
+ * joined in order and the last one back to the first one. The first point
+ * may be repeated at the end or not, a repeated point only adds a zero-length
+ * closing segment.
+ */
+
+/* Cumulative lengths of a ring, computed once: the length of the lines
+ * between any two vertices is then a subtraction, O(1) instead of
+ * O(vertices between them).
+ *
+ * The lengths don't reference the points: they can outlive them. The
+ * constructor takes a Span<P> or a Span<const P>, build() is called with an
+ * explicit P (build<P>(points)) like the other functions of the library.
+ */
+class RingLengths
+{
+public:
+    RingLengths() {}
+
+    template <typename P>
+    explicit RingLengths(Span<P> points)
+    {
+        build<typename std::remove_const<P>::type>(points);
+    }
+
+    template <typename P>
+    void build(Span<const typename NonDeduced<P>::type> points)
+    {
+        _dists.clear();
+        if (points.empty())
+            return;
+
+        // _dists[i] = length from points[0] to points[i], _dists[n] = perimeter
+        _dists.resize(points.size + 1);
+        _dists[0] = 0.;
+        for (size_t i = 1; i <= points.size; ++i)
+            _dists[i] = _dists[i - 1] + distance(points[i - 1], points[i % points.size]);
+    }
+
+    size_t vertexCount() const { return _dists.empty() ? 0 : _dists.size() - 1; }
+    double perimeter() const { return _dists.empty() ? 0. : _dists.back(); }
+
+    /* Distance from the first vertex to vertex i, along the ring. */
+    double distanceTo(const size_t i) const { return _dists[i]; }
+
+    /* Length of the lines from vertex p1 to vertex p2 going forward, wrapping
+     * around the first vertex if p1 > p2 (same as linesLengthBetween2Points,
+     * up to rounding). 0 if p1 == p2 or a vertex is out of range. */
+    double lengthBetween(const size_t p1, const size_t p2) const
+    {
+        if (p1 >= vertexCount() || p2 >= vertexCount() || p1 == p2)
+            return 0.;
+        return p1 < p2 ? _dists[p2] - _dists[p1] : perimeter() - (_dists[p1] - _dists[p2]);
+    }
+
+private:
+    std::vector<double> _dists;
+};
+
+/* Arc-length parametrization of a ring: outputs dataCount + 1 points along
+ * 'input' (closing segment included), the first one at the distance
+ * 'startOffset' from input[0] along the ring (any value, taken modulo the
+ * perimeter), the last one equal to the first. Output segment i maps data i,
+ * as with resampleArcLength().
+ *
+ * The output distances are swept once against the cumulative distances,
+ * wrapping around at most once: O(input.size + dataCount). 'dists' is a
+ * scratch buffer of input.size + 1 elements.
+ *
+ * Returns the number of points written (0 if the input has less than 2
+ * points, dataCount <= 0 or a buffer is too small). A ring of length 0
+ * outputs input[0] everywhere.
+ */
+template <typename P, typename Precision = FloatPrecision>
+size_t resampleRing(Span<const typename NonDeduced<P>::type> input, const int dataCount, const double startOffset,
+    Span<P> output, Span<typename Precision::Real> dists)
+{
+    typedef PointTraits<P> Traits;
+    typedef typename Traits::Scalar Scalar;
+    typedef typename Precision::Real Real;
+
+    const size_t outputCount = outputPointsCount(dataCount);
+    const size_t n = input.size;
+    if (n < 2 || outputCount == 0 || output.size < outputCount || dists.size < n + 1)
+        return 0;
+
+    // dists[j] = length from input[0] to the ring vertex j (input[j % n])
+    typename Precision::Sum sum;
+    dists[0] = 0;
+    for (size_t j = 1; j <= n; ++j)
+    {
+        sum.add(distance(input[j - 1], input[j % n]));
+        dists[j] = sum.value();
+    }
+
+    const double perimeter = double(dists[n]);
+    if (!(perimeter > 0.) || !std::isfinite(perimeter))
+    {
+        for (size_t i = 0; i < outputCount; ++i)
+            output[i] = input[0];
+        return outputCount;
+    }
+
+    double offset = std::isfinite(startOffset) ? std::fmod(startOffset, perimeter) : 0.;
+    if (offset < 0.)
+        offset += perimeter;
+    const double step = perimeter / dataCount;
+
+    // first segment whose end is at or beyond the start offset
+    size_t segment_idx = size_t(std::lower_bound(dists.begin() + 1, dists.begin() + n + 1, Real(offset)) - dists.begin());
+    bool wrapped = false;
+    for (size_t i = 0; i < size_t(dataCount); ++i)
+    {
+        double s = offset + double(i) * step;
+        if (s >= perimeter)
+        {
+            s -= perimeter;
+            if (!wrapped)
+            {
+                wrapped = true;
+                segment_idx = 1;
+            }
+        }
+
+        const Real total_dist = Real(s);
+        while (segment_idx < n && total_dist > dists[segment_idx])
+            ++segment_idx;
+
+        const Real segmentLength = dists[segment_idx] - dists[segment_idx - 1];
+        Real t = segmentLength > 0 ? (total_dist - dists[segment_idx - 1]) / segmentLength : Real(0);
+        t = t < 0 ? Real(0) : (t > 1 ? Real(1) : t);
+        const double u = double(1 - t);
+        const P& a = input[segment_idx - 1];
+        const P& b = input[segment_idx % n];
+        output[i] = Traits::make(Scalar(u * Traits::x(a) + t * Traits::x(b)),
+                                 Scalar(u * Traits::y(a) + t * Traits::y(b)));
+    }
+    output[size_t(dataCount)] = output[0];
+
+    return outputCount;
+}
+
+template <typename P, typename Precision = FloatPrecision>
+size_t resampleRing(Span<const typename NonDeduced<P>::type> input, const int dataCount, const double startOffset,
+    Span<P> output)
+{
+    std::vector<typename Precision::Real> dists(input.size + 1);
+    return resampleRing<P, Precision>(input, dataCount, startOffset, output, makeSpan(dists));
+}
+
+}
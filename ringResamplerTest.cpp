@@ -0,0 +1,191 @@
+#include "ringResampler.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+/* Checks resampleRing() against a brute-force walk along the ring in double
+ * precision, on random rings with and without a repeated closing vertex and
+ * with zero-length edges, for start offsets that are negative, equal to the
+ * perimeter or several times around it; a ring of length 0 outputs its first
+ * point everywhere. Checks RingLengths::lengthBetween() on every pair of
+ * vertices (p1 > p2 wraps around) against linesLengthBetween2Points().
+ * Returns non-zero on failure.
+ */
+
+namespace
+{
+
+typedef LineSplitter::Point2<double> Point;
+
+int g_failures = 0;
+
+double perimeterOf(const std::vector<Point>& ring)
+{
+    double perimeter = 0.;
+    for (size_t j = 0; j < ring.size(); ++j)
+        perimeter += LineSplitter::distance(ring[j], ring[(j + 1) % ring.size()]);
+    return perimeter;
+}
+
+// point at the distance s along the ring from ring[0], walking the edges one by one
+Point pointAt(const std::vector<Point>& ring, double s)
+{
+    const double perimeter = perimeterOf(ring);
+    s = std::fmod(s, perimeter);
+    if (s < 0.)
+        s += perimeter;
+
+    for (size_t j = 0; j < ring.size(); ++j)
+    {
+        const Point& a = ring[j];
+        const Point& b = ring[(j + 1) % ring.size()];
+        const double length = LineSplitter::distance(a, b);
+        if (s <= length || j + 1 == ring.size())
+        {
+            const double t = length > 0. ? std::min(1., s / length) : 0.;
+            return Point{ a.x + t * (b.x - a.x), a.y + t * (b.y - a.y) };
+        }
+        s -= length;
+    }
+    return ring[0];
+}
+
+// random ring around the origin: every 'repeat'-th vertex repeated if 'repeat' > 0,
+// the first vertex repeated at the end if 'closed'
+std::vector<Point> makeRing(std::mt19937& rng, const size_t count, const size_t repeat, const bool closed)
+{
+    std::uniform_real_distribution<double> radius(50., 100.);
+    std::vector<Point> ring;
+    for (size_t j = 0; j < count; ++j)
+    {
+        const double angle = 2. * std::acos(-1.) * double(j) / double(count);
+        const double r = radius(rng);
+        ring.push_back(Point{ r * std::cos(angle), r * std::sin(angle) });
+        if (repeat > 0 && j % repeat == 0)
+            ring.push_back(ring.back());
+    }
+    if (closed)
+        ring.push_back(ring[0]);
+    return ring;
+}
+
+template <typename Precision>
+void checkRing(const char* name, const std::vector<Point>& ring, const int dataCount, const double startOffset,
+    const double tolerance)
+{
+    std::vector<Point> output(LineSplitter::outputPointsCount(dataCount));
+    const size_t count = LineSplitter::resampleRing<Point, Precision>(LineSplitter::makeSpan(ring), dataCount,
+        startOffset, LineSplitter::makeSpan(output));
+    if (count != output.size())
+    {
+        std::fprintf(stderr, "FAIL %s: %zu points instead of %zu\n", name, count, output.size());
+        ++g_failures;
+        return;
+    }
+
+    const double perimeter = perimeterOf(ring);
+    const double offset = std::isfinite(startOffset) ? startOffset : 0.;
+    double error = 0.;
+    for (int i = 0; i < dataCount; ++i)
+    {
+        const Point expected = pointAt(ring, offset + double(i) * perimeter / dataCount);
+        const double e = std::hypot(output[size_t(i)].x - expected.x, output[size_t(i)].y - expected.y);
+        error = std::isnan(e) ? HUGE_VAL : std::max(error, e);
+    }
+    const bool closed = output[size_t(dataCount)].x == output[0].x && output[size_t(dataCount)].y == output[0].y;
+
+    if (!(error <= tolerance * perimeter) || !closed)
+    {
+        std::fprintf(stderr, "FAIL %s, %zu vertices, %d data, offset %g: error %g (perimeter %g)%s\n", name,
+            ring.size(), dataCount, startOffset, error, perimeter, closed ? "" : ", last point != first point");
+        ++g_failures;
+    }
+}
+
+void checkLengths(const std::vector<Point>& ring)
+{
+    const LineSplitter::RingLengths lengths(LineSplitter::makeSpan(ring));
+    const double perimeter = perimeterOf(ring);
+    if (lengths.vertexCount() != ring.size() || std::fabs(lengths.perimeter() - perimeter) > 1e-12 * perimeter)
+    {
+        std::fprintf(stderr, "FAIL RingLengths, %zu vertices: %zu vertices, perimeter %g instead of %g\n",
+            ring.size(), lengths.vertexCount(), lengths.perimeter(), perimeter);
+        ++g_failures;
+    }
+
+    for (size_t p1 = 0; p1 <= ring.size(); ++p1)
+        for (size_t p2 = 0; p2 <= ring.size(); ++p2)
+        {
+            const double expected = LineSplitter::linesLengthBetween2Points(LineSplitter::makeSpan(ring), p1, p2);
+            const double length = lengths.lengthBetween(p1, p2);
+            if (std::fabs(length - expected) > 1e-12 * perimeter)
+            {
+                std::fprintf(stderr, "FAIL lengthBetween(%zu, %zu), %zu vertices: %g instead of %g\n", p1, p2,
+                    ring.size(), length, expected);
+                ++g_failures;
+            }
+        }
+}
+
+}
+
+int main()
+{
+    std::mt19937 rng(42);
+    for (const size_t count : { 2, 3, 4, 7, 50, 100 })
+        for (const size_t repeat : { 0, 1, 3 })
+            for (const bool closed : { false, true })
+            {
+                const std::vector<Point> ring = makeRing(rng, count, repeat, closed);
+                const double perimeter = perimeterOf(ring);
+                checkLengths(ring);
+
+                const double offsets[] = { 0., 0.3 * perimeter, -0.3 * perimeter, -1e-3 * perimeter,
+                    -2.7 * perimeter, perimeter, -perimeter, 5. * perimeter, std::nan(""), HUGE_VAL };
+                for (const double offset : offsets)
+                    for (const int dataCount : { 1, 2, 5, int(ring.size()), 3 * int(ring.size()) + 1 })
+                    {
+                        checkRing<LineSplitter::DoublePrecision>("double", ring, dataCount, offset, 1e-12);
+                        checkRing<LineSplitter::FloatPrecision>("float", ring, dataCount, offset, 1e-5);
+                    }
+            }
+
+    // an offset equal to the perimeter (or a multiple of it) starts at the first vertex
+    const std::vector<Point> ring = makeRing(rng, 20, 3, true);
+    const double perimeter = LineSplitter::RingLengths(LineSplitter::makeSpan(ring)).perimeter();
+    std::vector<Point> atZero(11), atPerimeter(11);
+    LineSplitter::resampleRing<Point, LineSplitter::DoublePrecision>(LineSplitter::makeSpan(ring), 10, 0.,
+        LineSplitter::makeSpan(atZero));
+    LineSplitter::resampleRing<Point, LineSplitter::DoublePrecision>(LineSplitter::makeSpan(ring), 10, perimeter,
+        LineSplitter::makeSpan(atPerimeter));
+    if (atPerimeter[0].x != ring[0].x || atPerimeter[0].y != ring[0].y)
+    {
+        std::fprintf(stderr, "FAIL offset = perimeter: the first point isn't the first vertex\n");
+        ++g_failures;
+    }
+    for (size_t i = 0; i < atZero.size(); ++i)
+        if (std::hypot(atZero[i].x - atPerimeter[i].x, atZero[i].y - atPerimeter[i].y) > 1e-12 * perimeter)
+        {
+            std::fprintf(stderr, "FAIL offset = perimeter: point %zu differs from offset 0\n", i);
+            ++g_failures;
+            break;
+        }
+
+    // ring of length 0: the first point everywhere, no NaN
+    const std::vector<Point> degenerate(5, Point{ 3., 4. });
+    std::vector<Point> output(8);
+    const size_t count = LineSplitter::resampleRing<Point>(LineSplitter::makeSpan(degenerate), 7, 1.5,
+        LineSplitter::makeSpan(output));
+    for (const Point& p : output)
+        if (count != output.size() || p.x != 3. || p.y != 4.)
+        {
+            std::fprintf(stderr, "FAIL ring of length 0: (%g, %g)\n", p.x, p.y);
+            ++g_failures;
+            break;
+        }
+
+    std::printf("%d failure(s)\n", g_failures);
+    return g_failures == 0 ? 0 : 1;
+}
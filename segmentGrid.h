@@ -0,0 +1,252 @@
+#pragma once
+
+#include "lineSplitter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace LineSplitter
+{
+
+/* Uniform grid over a set of segments, built in bulk (two passes, CSR
+ * layout: no allocation per cell) once the segments are known, e.g. right
+ * after resampling.
+ *
+ * The grid covers the bounding box of the segments with about one cell per
+ * segment; a segment is stored in every cell its bounding box overlaps. The
+ * grid keeps a copy of the end points, so it doesn't depend on the segments
+ * after build().
+ *
+ * Segments with a NaN or infinite coordinate are not indexed.
+ */
+class SegmentGrid
+{
+public:
+    static const size_t npos = size_t(-1);
+
+    SegmentGrid() {}
+
+    template <typename Segments>
+    explicit SegmentGrid(const Segments& segments)
+    {
+        build(segments);
+    }
+
+    /* 'Segments': SegmentView or any view with a Point typedef, size(),
+     * p1(i) and p2(i). */
+    template <typename Segments>
+    void build(const Segments& segments)
+    {
+        typedef PointTraits<typename Segments::Point> Traits;
+
+        const size_t count = segments.size();
+        _ends.resize(count);
+        double minX = HUGE_VAL, minY = HUGE_VAL;
+        double maxX = -HUGE_VAL, maxY = -HUGE_VAL;
+        for (size_t i = 0; i < count; ++i)
+        {
+            Ends& e = _ends[i];
+            e.x1 = double(Traits::x(segments.p1(i)));
+            e.y1 = double(Traits::y(segments.p1(i)));
+            e.x2 = double(Traits::x(segments.p2(i)));
+            e.y2 = double(Traits::y(segments.p2(i)));
+            if (!e.isFinite())
+                continue;
+            minX = std::min(minX, std::min(e.x1, e.x2));
+            minY = std::min(minY, std::min(e.y1, e.y2));
+            maxX = std::max(maxX, std::max(e.x1, e.x2));
+            maxY = std::max(maxY, std::max(e.y1, e.y2));
+        }
+
+        _cellOffsets.assign(1, 0);
+        _cellSegments.clear();
+        _cellsX = _cellsY = 0;
+        if (minX > maxX)
+            return; // nothing to index
+
+        // about one cell per segment, square cells (a flat box gets a row of cells)
+        const double width = maxX - minX;
+        const double height = maxY - minY;
+        const double targetCells = double(std::min(std::max<size_t>(count, 1), size_t(MaxCells)));
+        double cellSize = width > 0. && height > 0. ? std::sqrt(width * height / targetCells)
+                                                    : std::max(width, height) / targetCells;
+        if (!(cellSize > 0.))
+            cellSize = 1.;
+
+        _originX = minX;
+        _originY = minY;
+        _inverseCellSize = 1. / cellSize;
+        _cellsX = int(std::min(double(MaxCellsPerAxis), std::floor(width * _inverseCellSize) + 1.));
+        _cellsY = int(std::min(double(MaxCellsPerAxis), std::floor(height * _inverseCellSize) + 1.));
+
+        const size_t cellCount = size_t(_cellsX) * _cellsY;
+        _cellOffsets.assign(cellCount + 1, 0);
+        std::vector<uint32_t> cursor;
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                const Ends& e = _ends[i];
+                if (!e.isFinite())
+                    continue;
+
+                const CellRange r = cells(e.minX(), e.minY(), e.maxX(), e.maxY());
+                for (int cy = r.y0; cy <= r.y1; ++cy)
+                    for (int cx = r.x0; cx <= r.x1; ++cx)
+                    {
+                        const size_t cell = size_t(cy) * _cellsX + cx;
+                        if (pass == 0)
+                            ++_cellOffsets[cell + 1];
+                        else
+                            _cellSegments[cursor[cell]++] = uint32_t(i);
+                    }
+            }
+
+            if (pass == 0)
+            {
+                for (size_t c = 0; c < cellCount; ++c)
+                    _cellOffsets[c + 1] += _cellOffsets[c];
+                _cellSegments.resize(_cellOffsets[cellCount]);
+                cursor.assign(_cellOffsets.begin(), _cellOffsets.end() - 1);
+            }
+        }
+    }
+
+    size_t segmentCount() const { return _ends.size(); }
+
+    /* Appends to 'indices', in ascending order, the segments whose bounding
+     * box, grown by 'margin' (e.g. half the line width), intersects the
+     * rectangle [x0, x1] x [y0, y1]. Returns the number of segments found.
+     *
+     * Costs O(cells of the rectangle + segments found): a viewport over a
+     * small part of the set only visits that part.
+     */
+    size_t query(const double x0, const double y0, const double x1, const double y1, const double margin,
+        std::vector<uint32_t>& indices) const
+    {
+        if (_cellsX == 0 || !(x0 <= x1) || !(y0 <= y1))
+            return 0;
+
+        const size_t first = indices.size();
+        const CellRange q = cells(x0 - margin, y0 - margin, x1 + margin, y1 + margin);
+        for (int cy = q.y0; cy <= q.y1; ++cy)
+            for (int cx = q.x0; cx <= q.x1; ++cx)
+            {
+                const size_t cell = size_t(cy) * _cellsX + cx;
+                for (uint32_t k = _cellOffsets[cell]; k < _cellOffsets[cell + 1]; ++k)
+                {
+                    const uint32_t i = _cellSegments[k];
+                    const Ends& e = _ends[i];
+                    if (e.maxX() + margin < x0 || e.minX() - margin > x1
+                        || e.maxY() + margin < y0 || e.minY() - margin > y1)
+                        continue;
+
+                    // a segment spanning several cells of the query is only
+                    // reported by the first of them
+                    const CellRange s = cells(e.minX(), e.minY(), e.maxX(), e.maxY());
+                    if (cx == std::max(s.x0, q.x0) && cy == std::max(s.y0, q.y0))
+                        indices.push_back(i);
+                }
+            }
+
+        std::sort(indices.begin() + first, indices.end());
+        return indices.size() - first;
+    }
+
+    /* Segment closest to (x, y) among those at 'maxDistance' or less (the
+     * last one, i.e. the one drawn on top, if several are as close), or npos.
+     */
+    size_t nearest(const double x, const double y, const double maxDistance) const
+    {
+        if (_cellsX == 0 || !(maxDistance >= 0.))
+            return npos;
+
+        size_t found = npos;
+        double best = maxDistance * maxDistance;
+        const CellRange q = cells(x - maxDistance, y - maxDistance, x + maxDistance, y + maxDistance);
+        for (int cy = q.y0; cy <= q.y1; ++cy)
+            for (int cx = q.x0; cx <= q.x1; ++cx)
+            {
+                const size_t cell = size_t(cy) * _cellsX + cx;
+                for (uint32_t k = _cellOffsets[cell]; k < _cellOffsets[cell + 1]; ++k)
+                {
+                    const uint32_t i = _cellSegments[k];
+                    const double d = _ends[i].squaredDistance(x, y);
+                    if (d < best || (d == best && (found == npos || i > found)))
+                    {
+                        best = d;
+                        found = i;
+                    }
+                }
+            }
+
+        return found;
+    }
+
+private:
+    static const size_t MaxCells = size_t(1) << 22;
+    static const int MaxCellsPerAxis = 1 << 16;
+
+    struct Ends
+    {
+        double x1, y1, x2, y2;
+
+        bool isFinite() const
+        {
+            return std::isfinite(x1) && std::isfinite(y1) && std::isfinite(x2) && std::isfinite(y2);
+        }
+
+        double minX() const { return std::min(x1, x2); }
+        double minY() const { return std::min(y1, y2); }
+        double maxX() const { return std::max(x1, x2); }
+        double maxY() const { return std::max(y1, y2); }
+
+        double squaredDistance(const double x, const double y) const
+        {
+            const double dx = x2 - x1;
+            const double dy = y2 - y1;
+            const double squaredLength = dx * dx + dy * dy;
+            double t = squaredLength > 0. ? ((x - x1) * dx + (y - y1) * dy) / squaredLength : 0.;
+            t = t < 0. ? 0. : (t > 1. ? 1. : t);
+            const double ex = x - x1 - t * dx;
+            const double ey = y - y1 - t * dy;
+            return ex * ex + ey * ey;
+        }
+    };
+
+    struct CellRange
+    {
+        int x0, y0, x1, y1;
+    };
+
+    int cellX(const double x) const
+    {
+        const double c = std::floor((x - _originX) * _inverseCellSize);
+        return c < 0. ? 0 : (c >= _cellsX ? _cellsX - 1 : int(c));
+    }
+
+    int cellY(const double y) const
+    {
+        const double c = std::floor((y - _originY) * _inverseCellSize);
+        return c < 0. ? 0 : (c >= _cellsY ? _cellsY - 1 : int(c));
+    }
+
+    CellRange cells(const double x0, const double y0, const double x1, const double y1) const
+    {
+        const CellRange r = { cellX(x0), cellY(y0), cellX(x1), cellY(y1) };
+        return r;
+    }
+
+    std::vector<Ends> _ends;
+    std::vector<uint32_t> _cellOffsets; // CSR: segments of cell c in [_cellOffsets[c], _cellOffsets[c + 1])
+    std::vector<uint32_t> _cellSegments;
+    double _originX = 0.;
+    double _originY = 0.;
+    double _inverseCellSize = 1.;
+    int _cellsX = 0;
+    int _cellsY = 0;
+};
+
+}
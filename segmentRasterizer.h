@@ -0,0 +1,330 @@
+#pragma once
+
+#include "lineSplitterParallel.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace LineSplitter
+{
+
+/* Caller-owned 32-bit image, premultiplied ARGB (the layout of
+ * QImage::Format_ARGB32_Premultiplied). 'stride' is in pixels. */
+struct RasterImage
+{
+    uint32_t* pixels;
+    int width;
+    int height;
+    size_t stride;
+};
+
+namespace detail
+{
+
+// x * a / 255 on the 4 channels of x (a in [0, 255])
+inline uint32_t byteMul(uint32_t x, const uint32_t a)
+{
+    uint32_t t = (x & 0xff00ff) * a;
+    t = (t + ((t >> 8) & 0xff00ff) + 0x800080) >> 8;
+    t &= 0xff00ff;
+
+    x = ((x >> 8) & 0xff00ff) * a;
+    x = x + ((x >> 8) & 0xff00ff) + 0x800080;
+    x &= 0xff00ff00;
+    return x | t;
+}
+
+inline uint32_t premultiply(const uint32_t argb)
+{
+    return byteMul(argb | 0xff000000u, argb >> 24);
+}
+
+/* floor(v) clamped to [lo, hi] (v clamped in double first: converting a
+ * double out of the range of int is undefined, and a segment crossing the
+ * image may end billions of pixels away). NaN gives lo. */
+inline int clampedFloor(const double v, const int lo, const int hi)
+{
+    return v > lo ? (v < hi ? int(std::floor(v)) : hi) : lo;
+}
+
+inline int clampedCeil(const double v, const int lo, const int hi)
+{
+    return v > lo ? (v < hi ? int(std::ceil(v)) : hi) : lo;
+}
+
+/* Interval of x where lo <= a * x + b <= hi, intersected with [x0, x1]. */
+inline void clipLinear(const double a, const double b, const double lo, const double hi, double& x0, double& x1)
+{
+    if (a == 0.)
+    {
+        if (b < lo || b > hi)
+            x1 = x0 - 1.;
+        return;
+    }
+
+    double from = (lo - b) / a;
+    double to = (hi - b) / a;
+    if (a < 0.)
+        std::swap(from, to);
+    x0 = std::max(x0, from);
+    x1 = std::min(x1, to);
+}
+
+/* Clips the segment a-b to the rectangle [x0, x1] x [y0, y1]. False if it
+ * doesn't cross the rectangle or a coordinate isn't finite. */
+inline bool clipSegment(double& ax, double& ay, double& bx, double& by,
+    const double x0, const double y0, const double x1, const double y1)
+{
+    const double dx = bx - ax;
+    const double dy = by - ay;
+    if (!std::isfinite(dx) || !std::isfinite(dy))
+        return false;
+
+    double from = 0.;
+    double to = 1.;
+    clipLinear(dx, ax, x0, x1, from, to);
+    clipLinear(dy, ay, y0, y1, from, to);
+    if (!(from <= to))
+        return false;
+
+    bx = to < 1. ? ax + to * dx : bx;
+    by = to < 1. ? ay + to * dy : by;
+    ax = from > 0. ? ax + from * dx : ax;
+    ay = from > 0. ? ay + from * dy : ay;
+    return true;
+}
+
+/* Capsule (segment a-b thickened by 'radius', round caps): its bounding box,
+ * the x interval it covers on a row, and the distance from its axis. */
+class Capsule
+{
+public:
+    Capsule() : Capsule(0., 0., 0., 0., 0.) {}
+    Capsule(const double ax, const double ay, const double bx, const double by, const double radius) :
+        _ax(ax), _ay(ay), _dx(bx - ax), _dy(by - ay), _radius(radius)
+    {
+        _squaredLength = _dx * _dx + _dy * _dy;
+        _length = std::sqrt(_squaredLength);
+        _inverseSquaredLength = _squaredLength > 0. ? 1. / _squaredLength : 0.;
+    }
+
+    double minX() const { return std::min(_ax, _ax + _dx) - _radius; }
+    double maxX() const { return std::max(_ax, _ax + _dx) + _radius; }
+    double minY() const { return std::min(_ay, _ay + _dy) - _radius; }
+    double maxY() const { return std::max(_ay, _ay + _dy) + _radius; }
+
+    /* Union of the caps and of the band between them on the row y (the
+     * capsule is convex: the union is an interval). False if empty. */
+    bool row(const double y, double& x0, double& x1) const
+    {
+        x0 = std::numeric_limits<double>::max();
+        x1 = -x0;
+        cap(_ax, _ay, y, x0, x1);
+        cap(_ax + _dx, _ay + _dy, y, x0, x1);
+
+        if (_length > 0.)
+        {
+            // 0 <= projection on the axis <= 1, |distance to the axis| <= radius
+            double from = -std::numeric_limits<double>::max();
+            double to = -from;
+            const double ry = y - _ay;
+            clipLinear(_dx / _squaredLength, (ry * _dy - _ax * _dx) / _squaredLength, 0., 1., from, to);
+            clipLinear(-_dy / _length, (ry * _dx + _ax * _dy) / _length, -_radius, _radius, from, to);
+            if (from <= to)
+            {
+                x0 = std::min(x0, from);
+                x1 = std::max(x1, to);
+            }
+        }
+        return x0 <= x1;
+    }
+
+    double squaredDistance(const double x, const double y) const
+    {
+        const double px = x - _ax;
+        const double py = y - _ay;
+        double t = (px * _dx + py * _dy) * _inverseSquaredLength;
+        t = t < 0. ? 0. : (t > 1. ? 1. : t);
+        const double ex = px - t * _dx;
+        const double ey = py - t * _dy;
+        return ex * ex + ey * ey;
+    }
+
+    double distance(const double x, const double y) const
+    {
+        return std::sqrt(squaredDistance(x, y));
+    }
+
+    /* Whether the capsule may overlap the rectangle [x0, x1] x [y0, y1]
+     * (conservative: distance from the rectangle center to the axis). */
+    bool mayOverlap(const double x0, const double y0, const double x1, const double y1) const
+    {
+        const double halfDiagonal = 0.5 * std::sqrt((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0));
+        return distance(0.5 * (x0 + x1), 0.5 * (y0 + y1)) <= _radius + halfDiagonal;
+    }
+
+private:
+    void cap(const double cx, const double cy, const double y, double& x0, double& x1) const
+    {
+        const double dy = y - cy;
+        if (dy * dy > _radius * _radius)
+            return;
+        const double halfWidth = std::sqrt(_radius * _radius - dy * dy);
+        x0 = std::min(x0, cx - halfWidth);
+        x1 = std::max(x1, cx + halfWidth);
+    }
+
+    double _ax, _ay;
+    double _dx, _dy;
+    double _radius;
+    double _squaredLength;
+    double _length;
+    double _inverseSquaredLength;
+};
+
+}
+
+/* Draws segments of width 'lineWidth' with round caps into 'image',
+ * antialiased, segment i with the (non premultiplied) ARGB color colors[i]
+ * composited over the image ("source over"), in the order of the segments.
+ *
+ * The image is split into tiles of 'tileSize' pixels: the segments are first
+ * binned by tile, then every tile is rasterized scanline by scanline on its
+ * own, on 'threadCount' threads (0 uses all the hardware threads). The
+ * result doesn't depend on the number of threads.
+ *
+ * The segments may end anywhere (billions of pixels away when zoomed in):
+ * they are clipped to the image before being binned.
+ *
+ * 'Segments': SegmentView or any view with a Point typedef, size(), p1(i)
+ * and p2(i) (e.g. a subset of the segments found by SegmentGrid::query()).
+ *
+ * Returns the number of segments drawn (colors may be shorter than the
+ * segments: the extra segments are not drawn).
+ */
+template <typename Segments>
+size_t rasterizeSegments(const Segments& segments, Span<const uint32_t> colors, const double lineWidth,
+    const RasterImage& image, unsigned threadCount = 0, const int tileSize = 64)
+{
+    typedef typename Segments::Point P;
+    typedef PointTraits<P> Traits;
+
+    const size_t segmentCount = std::min(segments.size(), colors.size);
+    if (segmentCount == 0 || image.width <= 0 || image.height <= 0 || lineWidth <= 0. || tileSize <= 0)
+        return 0;
+
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    // coverage of a pixel = radius - distance of its center, clamped to [0, 1]
+    // (i.e. half a pixel of antialiasing on both sides of the line edges)
+    const double radius = 0.5 * lineWidth + 0.5;
+    const double squaredRadius = radius * radius;
+    const double squaredInnerRadius = radius > 1. ? (radius - 1.) * (radius - 1.) : 0.;
+    // the segments are clipped to the image plus a margin the caps don't
+    // cross: the parts drawn are unchanged, the coordinates stay small
+    const double margin = radius + 1.;
+    auto clippedCapsule = [&](const size_t i, detail::Capsule& c) {
+        const P& a = segments.p1(i);
+        const P& b = segments.p2(i);
+        double ax = Traits::x(a), ay = Traits::y(a), bx = Traits::x(b), by = Traits::y(b);
+        if (!detail::clipSegment(ax, ay, bx, by, -margin, -margin, image.width + margin, image.height + margin))
+            return false;
+        c = detail::Capsule(ax, ay, bx, by, radius);
+        return true;
+    };
+
+    const int tilesX = (image.width + tileSize - 1) / tileSize;
+    const int tilesY = (image.height + tileSize - 1) / tileSize;
+    const size_t tileCount = size_t(tilesX) * tilesY;
+
+    // bins (tile -> segments, in drawing order) in CSR layout, filled in two passes
+    std::vector<size_t> binOffsets(tileCount + 1, 0);
+    std::vector<uint32_t> bins;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        std::vector<size_t> cursor(binOffsets.begin(), binOffsets.end() - 1);
+        for (size_t i = 0; i < segmentCount; ++i)
+        {
+            detail::Capsule c;
+            if (!clippedCapsule(i, c) || c.maxX() < 0. || c.maxY() < 0. || c.minX() > image.width
+                || c.minY() > image.height)
+                continue;
+            const int tx0 = detail::clampedFloor(c.minX(), 0, image.width - 1) / tileSize;
+            const int ty0 = detail::clampedFloor(c.minY(), 0, image.height - 1) / tileSize;
+            const int tx1 = detail::clampedFloor(c.maxX(), 0, image.width - 1) / tileSize;
+            const int ty1 = detail::clampedFloor(c.maxY(), 0, image.height - 1) / tileSize;
+
+            for (int ty = ty0; ty <= ty1; ++ty)
+                for (int tx = tx0; tx <= tx1; ++tx)
+                {
+                    // a bounding box of a single row or column of tiles has no empty tile
+                    if (tx0 != tx1 && ty0 != ty1
+                        && !c.mayOverlap(tx * tileSize, ty * tileSize, (tx + 1) * tileSize, (ty + 1) * tileSize))
+                        continue;
+
+                    const size_t tile = size_t(ty) * tilesX + tx;
+                    if (pass == 0)
+                        ++binOffsets[tile + 1];
+                    else
+                        bins[cursor[tile]++] = uint32_t(i);
+                }
+        }
+
+        if (pass == 0)
+        {
+            for (size_t t = 0; t < tileCount; ++t)
+                binOffsets[t + 1] += binOffsets[t];
+            bins.resize(binOffsets[tileCount]);
+        }
+    }
+
+    std::vector<uint32_t> premultiplied(segmentCount);
+    for (size_t i = 0; i < segmentCount; ++i)
+        premultiplied[i] = detail::premultiply(colors[i]);
+
+    detail::parallelFor(tileCount, threadCount, [&](const size_t tile, const unsigned) {
+        const int tileX0 = int(tile % tilesX) * tileSize;
+        const int tileY0 = int(tile / tilesX) * tileSize;
+        const int tileX1 = std::min(image.width, tileX0 + tileSize) - 1;
+        const int tileY1 = std::min(image.height, tileY0 + tileSize) - 1;
+
+        for (size_t b = binOffsets[tile]; b < binOffsets[tile + 1]; ++b)
+        {
+            const size_t i = bins[b];
+            detail::Capsule c;
+            clippedCapsule(i, c); // binned: crosses the image
+            const uint32_t color = premultiplied[i];
+
+            const int y0 = detail::clampedFloor(c.minY(), tileY0, tileY1 + 1);
+            const int y1 = detail::clampedCeil(c.maxY(), tileY0 - 1, tileY1);
+            for (int y = y0; y <= y1; ++y)
+            {
+                // pixel centers are at +0.5
+                const double cy = y + 0.5;
+                double rowX0, rowX1;
+                if (!c.row(cy, rowX0, rowX1))
+                    continue;
+
+                const int x0 = detail::clampedCeil(rowX0 - 0.5, tileX0, tileX1 + 1);
+                const int x1 = detail::clampedFloor(rowX1 - 0.5, tileX0 - 1, tileX1);
+                uint32_t* line = image.pixels + size_t(y) * image.stride;
+                for (int x = x0; x <= x1; ++x)
+                {
+                    const double squaredDistance = c.squaredDistance(x + 0.5, cy);
+                    if (squaredDistance >= squaredRadius)
+                        continue;
+
+                    const uint32_t source = squaredDistance <= squaredInnerRadius ? color
+                        : detail::byteMul(color, uint32_t((radius - std::sqrt(squaredDistance)) * 255. + 0.5));
+                    line[x] = source + detail::byteMul(line[x], 255 - (source >> 24));
+                }
+            }
+        }
+    });
+
+    return segmentCount;
+}
+
+}
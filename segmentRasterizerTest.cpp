@@ -0,0 +1,109 @@
+#include "segmentRasterizer.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/* Checks that rasterizeSegments() draws a segment crossing the image the same
+ * way whether its endpoints are near the image or billions of pixels away
+ * (beyond the range of int), and that segments out of the image or with NaN
+ * coordinates draw nothing. Returns non-zero on failure.
+ */
+
+namespace
+{
+
+typedef LineSplitter::Point2<double> Point;
+
+const int Size = 200;
+
+std::vector<uint32_t> render(const Point& a, const Point& b, const double lineWidth)
+{
+    std::vector<uint32_t> pixels(size_t(Size) * Size, 0u);
+    const std::vector<Point> points = { a, b };
+    const uint32_t color = 0xff3080c0u;
+    const LineSplitter::RasterImage image = { pixels.data(), Size, Size, size_t(Size) };
+    LineSplitter::rasterizeSegments(LineSplitter::SegmentView<Point>(LineSplitter::makeSpan(points)),
+        LineSplitter::Span<const uint32_t>(&color, 1), lineWidth, image);
+    return pixels;
+}
+
+size_t litPixels(const std::vector<uint32_t>& pixels)
+{
+    size_t count = 0;
+    for (const uint32_t p : pixels)
+        count += p != 0u;
+    return count;
+}
+
+// largest difference of a channel between the two images
+int maxDifference(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b)
+{
+    int difference = 0;
+    for (size_t i = 0; i < a.size(); ++i)
+        for (int shift = 0; shift < 32; shift += 8)
+            difference = std::max(difference, std::abs(int((a[i] >> shift) & 0xff) - int((b[i] >> shift) & 0xff)));
+    return difference;
+}
+
+int g_failures = 0;
+
+// a segment with far endpoints against the same line with endpoints just out of the image
+void checkFar(const char* name, const Point& farA, const Point& farB, const Point& nearA, const Point& nearB,
+    const int tolerance)
+{
+    const std::vector<uint32_t> expected = render(nearA, nearB, 5.);
+    const std::vector<uint32_t> pixels = render(farA, farB, 5.);
+    const size_t expectedLit = litPixels(expected);
+    const size_t lit = litPixels(pixels);
+    const int difference = maxDifference(pixels, expected);
+    if (expectedLit == 0 || lit != expectedLit || difference > tolerance)
+    {
+        std::fprintf(stderr, "FAIL %s: %zu pixels lit instead of %zu, channel difference %d\n", name, lit,
+            expectedLit, difference);
+        ++g_failures;
+    }
+}
+
+void checkEmpty(const char* name, const Point& a, const Point& b)
+{
+    const size_t lit = litPixels(render(a, b, 5.));
+    if (lit != 0)
+    {
+        std::fprintf(stderr, "FAIL %s: %zu pixels lit instead of 0\n", name, lit);
+        ++g_failures;
+    }
+}
+
+}
+
+int main()
+{
+    // horizontal and vertical: the distance to the axis is exact, the images are identical
+    checkFar("horizontal 3e9", Point{ -3e9, 100. }, Point{ 3e9, 100. }, Point{ -10., 100. }, Point{ 210., 100. }, 0);
+    checkFar("horizontal 2e9", Point{ -2e9, 100. }, Point{ 2e9, 100. }, Point{ -10., 100. }, Point{ 210., 100. }, 0);
+    checkFar("vertical 1e12", Point{ 50., 1e12 }, Point{ 50., -1e12 }, Point{ 50., 210. }, Point{ 50., -10. }, 0);
+    checkFar("horizontal 1e15", Point{ -1e15, 20. }, Point{ 1e15, 20. }, Point{ -10., 20. }, Point{ 210., 20. }, 0);
+    // diagonal: the far endpoints round the distances, a channel may differ by 1
+    checkFar("diagonal 3e9", Point{ -3e9, -3e9 }, Point{ 3e9, 3e9 }, Point{ -10., -10. }, Point{ 210., 210. }, 1);
+    checkFar("diagonal 1e12", Point{ 1e12, -1e12 + 200. }, Point{ -1e12, 1e12 + 200. }, Point{ 210., -10. },
+        Point{ -10., 210. }, 1);
+
+    // endpoints too far for a double to place the line within a pixel: no
+    // undefined conversion, no NaN color, at most a band of the image
+    const size_t lit = litPixels(render(Point{ -1e300, 20. }, Point{ 1e300, 20. }, 5.));
+    if (lit > size_t(6) * Size)
+    {
+        std::fprintf(stderr, "FAIL horizontal 1e300: %zu pixels lit\n", lit);
+        ++g_failures;
+    }
+
+    checkEmpty("left of the image", Point{ -3e9, 100. }, Point{ -1e9, 100. });
+    checkEmpty("right of the image", Point{ 1e9, 100. }, Point{ 3e9, 100. });
+    checkEmpty("below the image", Point{ -3e9, 1e10 }, Point{ 3e9, 1e10 });
+    checkEmpty("NaN", Point{ std::nan(""), 100. }, Point{ 10., 100. });
+
+    std::printf("%d failure(s)\n", g_failures);
+    return g_failures == 0 ? 0 : 1;
+}